@@ -9,6 +9,7 @@
 #include "Arduino.h"
 #include "Windnerd_Core.h"
 #include "Windnerd_Wtp_Payload.h"
+#include "Windnerd_Modem.h"
 #include "stm32g0xx_hal.h"  // necessary to change clock settings
 
 #define WTP_SECRET_KEY "af3ffa12c4937ddf"  // Replace with the secret key for your WTP device
@@ -26,39 +27,34 @@ HardwareSerial SerialDebug(USART1);
 #endif
 
 #define REPORT_INTERVAL_MN 2  // Interval in minutes between uploading wind data via WindNerd Transfer Protocol (https://windnerd.net/docs/wind-transfer-protocol)
+                              // wind events (see setup) are uploaded as soon as they happen, so it can be raised to save energy
 #define NO_SLEEP_AFTER_START_UP_MN 5
 #define SKIP_SLEEP_EVERY 15   // in upload cycles
 #define REBOOT_MODEM_EVERY (30 * 24) // one reboot a day keeps the bugs away
 
 
 WN_Core Anemometer;
-HardwareSerial SerialOutput(USART2);  // to serial LTE modem (SIM7670E, SIM7080G, AIR780E...), only TX2 is used, RX2 is not read
+HardwareSerial SerialOutput(USART2);  // to serial LTE modem (SIM7670E, SIM7080G, AIR780E...), modem answers are read on RX2
 
 WN_WTP_PAYLOAD Wtp_payload;
+#ifdef ENABLE_BME_280
+WN_MODEM Modem(&SerialOutput);
+#else
+WN_MODEM Modem(&SerialOutput, &SerialDebug);  // modem answers are echoed on TX1
+#endif
 
 unsigned long last_uploading_time = millis();
 unsigned post_cnt = 1;
+bool wind_event = false;
 
-// steps for uploading wind data
-enum Modem_steps {
-  START = 0,
-#ifdef APN
-  SET_APN,
-#endif
-  TERMINATE,
-  INIT,
-  SET_URL,
-  SET_HEADERS,
-  SET_DATA,
-  POST,
+// steps for uploading wind data, each step is driven by the modem driver which waits for the modem answers
+enum Upload_steps {
+  POST = 0,
   GO_SLEEP,
   SLEEP,
 };
 
-// variables for the state machine
-unsigned long last_step_time = millis();
-unsigned long time_to_wait_before_next_step = 0;
-Modem_steps modem_step = SLEEP;
+Upload_steps upload_step = SLEEP;
 
 #ifdef ENABLE_VOLTAGE
 float getPowerVoltage() {
@@ -68,110 +64,67 @@ float getPowerVoltage() {
 #endif
 
 
-// non blocking wait for the next modem operation, delay parameter in ms
-void waitForNextStep(uint16_t time_to_wait) {
-  last_step_time = millis();
-  time_to_wait_before_next_step = time_to_wait;
-  modem_step = static_cast<Modem_steps>(modem_step + 1);
+// a front or a strong gust: upload now instead of waiting for the next interval
+void windEventCallback(wn_wind_event_t event) {
+  wind_event = true;
 }
 
-void sendCommandToModem(char *cmd) {
-  SerialOutput.println(cmd);  // command should end with line break
-}
 
-void sendTextToModem(char *txt) {
-  SerialOutput.print(txt);
+// set up the payload and start posting it, the driver sends the length to the modem before the payload
+void startUpload(unsigned period_mn) {
+  Wtp_payload.reset();
+  Wtp_payload.setAnemometer(&Anemometer);
+  Wtp_payload.setPeriodInMinutes(period_mn);
+  Wtp_payload.setSecretKey(WTP_SECRET_KEY);
+  Wtp_payload.enableWindSamples();
+#ifdef ENABLE_VOLTAGE
+  Wtp_payload.setVoltage(getPowerVoltage());
+#endif
+#ifdef ENABLE_BME_280
+  Wtp_payload.setTemperature(sensor.getTemperature());
+  Wtp_payload.setPressure(sensor.getPressure() / 100);
+  Wtp_payload.setHumidity(sensor.getHumidity());
+#endif
+  Modem.post(&Wtp_payload);
 }
 
 
-// non blocking state machine that sequentially sends AT commands and payloads
+// non blocking state machine: post, then put the modem to sleep once the driver is done
 void processModem() {
 
-  if (modem_step == START) {
-    sendCommandToModem("AT");
-    waitForNextStep(100);
+  Modem.loop();
+
+  if (Modem.isBusy()) {
     return;
   }
 
-  if (modem_step != SLEEP && (millis() - last_step_time > time_to_wait_before_next_step)) {
-
-#ifdef APN
-    if (modem_step == SET_APN) {
-      char buffer[64];
-      sprintf(buffer, "AT+CGDCONT=1,\"IP\",\"%s\"", APN);
-      sendCommandToModem(buffer);
-      waitForNextStep(100);
-      return;
-    }
-#endif
-
-    if (modem_step == TERMINATE) {
-      sendCommandToModem("AT+HTTPTERM");
-      waitForNextStep(100);
-      return;
-    }
-
-    if (modem_step == INIT) {
-      sendCommandToModem("AT+HTTPINIT");
-      waitForNextStep(100);  // on some A7670 (different firmware version?) HTTP INIT takes seconds! this timing might require increase
-      return;
-    }
-
-    if (modem_step == SET_URL) {
-      sendCommandToModem("AT+HTTPPARA=\"URL\",\"http://wtp.windnerd.net/post\"");
-      waitForNextStep(100);
-      return;
-    }
-
-    if (modem_step == SET_HEADERS) {
-
-      // setting headers is mainly about specifying the length of data transmitted at next step, we set up the payload now so the helper object can calculate the length
-      Wtp_payload.reset();
-      Wtp_payload.setAnemometer(&Anemometer);
-      Wtp_payload.setPeriodInMinutes(REPORT_INTERVAL_MN);
-      Wtp_payload.setSecretKey(WTP_SECRET_KEY);
-      Wtp_payload.enableWindSamples();
-#ifdef ENABLE_VOLTAGE
-      Wtp_payload.setVoltage(getPowerVoltage());
-#endif
-#ifdef ENABLE_BME_280
-      Wtp_payload.setTemperature(sensor.getTemperature());
-      Wtp_payload.setPressure(sensor.getPressure() / 100);
-      Wtp_payload.setHumidity(sensor.getHumidity());
-#endif
-
-      char buffer[32];
-      sprintf(buffer, "AT+HTTPDATA=%d,10000", Wtp_payload.calculatePayloadLength());
-      sendCommandToModem(buffer);
-      waitForNextStep(100);
-      return;
-    }
-
-    if (modem_step == SET_DATA) {
-      Wtp_payload.sendPayload(&SerialOutput);
-      waitForNextStep(200);
-      return;
-    }
-
-    if (modem_step == POST) {
-      sendCommandToModem("AT+HTTPACTION=1");  // perform POST request
-      waitForNextStep(2000);
-      return;
+  if (upload_step == POST) {
+    // whole minutes since the previous upload: the interval for a regular upload, which starts just after it,
+    // fewer after a wind event so the minutes already uploaded are not sent again
+    unsigned period_mn = (millis() - last_uploading_time) / 60000;
+    if (period_mn < 1) {
+      period_mn = 1;
+    } else if (period_mn > REPORT_INTERVAL_MN) {
+      period_mn = REPORT_INTERVAL_MN;
     }
+    startUpload(period_mn);
+    last_uploading_time = millis();
+    upload_step = GO_SLEEP;
+    return;
+  }
 
-    if (modem_step == GO_SLEEP) {
-      // we don't send modem to sleep immediately after start up to ensure enough time for attaching to mobile network
-      // we skip a sleep cycle periodically, to give a chance to recover if something went wrong
-      // we reboot the modem daily as extra precaution
-      if (post_cnt % REBOOT_MODEM_EVERY == 0) {
-        sendCommandToModem("AT+CPOF");
-      } else if (millis() > NO_SLEEP_AFTER_START_UP_MN * 60 * 1000 && post_cnt % SKIP_SLEEP_EVERY != 0) {
-        sendCommandToModem("AT+CSCLK=2");
-      }
-      modem_step = SLEEP;
-      post_cnt++;
-      return;
+  if (upload_step == GO_SLEEP) {
+    // we don't send modem to sleep immediately after start up to ensure enough time for attaching to mobile network
+    // we skip a sleep cycle periodically, to give a chance to recover if something went wrong
+    // we reboot the modem daily as extra precaution
+    if (post_cnt % REBOOT_MODEM_EVERY == 0) {
+      Modem.command("AT+CPOF");
+    } else if (millis() > NO_SLEEP_AFTER_START_UP_MN * 60 * 1000 && post_cnt % SKIP_SLEEP_EVERY != 0) {
+      Modem.command("AT+CSCLK=2");
     }
+    upload_step = SLEEP;
+    post_cnt++;
+    return;
   }
 }
 
@@ -194,7 +147,13 @@ static inline void feedWatchdog(void) {
 void setup() {
   initWatchdog();
   SerialOutput.begin(115200);
+#ifdef APN
+  Modem.setApn(APN);
+#endif
   Anemometer.invertVanePolarity(false);                 // change to true if you notice north and south are inverted
+  Anemometer.onWindEvent(&windEventCallback);
+  Anemometer.setSpeedTrigger(10, 2);                    // 1 minute mean reaching 10 m/s, again after falling below 8 m/s
+  Anemometer.setDirectionShiftTrigger(45, 10, 15, 3);   // direction turning by 45 degrees within 10 minutes, above 3 m/s
   Anemometer.begin();
 #ifdef ENABLE_BME_280
   Wire2.setSCL(PA11);
@@ -214,15 +173,15 @@ void loop() {
 
   Anemometer.loop();
 
-  // start the process for a new upload when time interval from last upload has expired
-  if (modem_step == SLEEP && (millis() - last_uploading_time > (REPORT_INTERVAL_MN * 60 * 1000))) {
-    modem_step = START;
-    last_uploading_time = millis();
+  // start the process for a new upload when time interval from last upload has expired or on a wind event
+  if (upload_step == SLEEP && (wind_event || millis() - last_uploading_time > (REPORT_INTERVAL_MN * 60 * 1000))) {
+    upload_step = POST;
+    wind_event = false;
   }
   processModem();
 
 
-  // put the MCU to sleep, the WindNerd Core library uses a timer interrupt to wake it up automatically every 100ms
+  // put the MCU to sleep, the WindNerd Core library uses a timer interrupt to wake it up automatically when needed
   HAL_PWR_EnterSLEEPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
 }
 
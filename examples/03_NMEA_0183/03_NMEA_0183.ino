@@ -8,6 +8,7 @@
 
 #include "Arduino.h"
 #include "Windnerd_Core.h"
+#include "Windnerd_Serial_Queue.h"
 #include "stm32g0xx_hal.h"  // necessary to change clock settings
 
 
@@ -15,6 +16,7 @@ WN_Core Anemometer;
 
 HardwareSerial SerialOutput(USART2);  // TX2 on WindNerd Core board (yellow wire)
 HardwareSerial SerialDebug(USART1);   // RX1 and TX1 on WindNerd Core board (headers connector)
+WN_SERIAL_QUEUE NmeaOutput(&SerialOutput);  // sentences are sent in the background, at 4800 bauds a sentence takes ~50 ms
 
 // called every 3 seconds, gives instant wind speed + direction
 void instantWindCallback(wn_instant_wind_sample_t sample) {
@@ -46,7 +48,7 @@ void instantWindCallback(wn_instant_wind_sample_t sample) {
   sentence.toUpperCase();
 
   // Send with CRLF
-  SerialOutput.println(sentence);
+  NmeaOutput.println(sentence);
 }
 
 
@@ -64,7 +66,7 @@ void setup() {
 
 void loop() {
   Anemometer.loop();
-
+  NmeaOutput.loop();
 
   // put the MCU to sleep, the WindNerd Core library uses a timer interrupt to wake it up automatically when needed
   HAL_PWR_EnterSLEEPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
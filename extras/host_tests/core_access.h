@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Opens WN_Core to the host tests and feeds it samples the way closeSamplingWindow() does,
+// without timers: one call is one 3 s sampling window.
+
+#pragma once
+#include "Wire.h"
+#include "HardwareTimer.h"
+#define private public
+#include "Windnerd_Core.h"
+#undef private
+#include <string>
+
+inline void feedSample(WN_Core &core, uint16_t pulses, uint16_t dir)
+{
+  wn_raw_wind_sample_t sample = {pulses, dir, true};
+  core.RollingBuffer.addRawSample(sample);
+#if WIND_ROSE
+  if (core._wind_rose)
+  {
+    core._wind_rose->add(core.pulsesToSpeedUnitInUse(pulses), dir, core.RollingBuffer.getTotalSamples() - 1);
+  }
+#endif
+  core.closeMinute();
+  core.triggerReportChannels();
+  core.evaluateEventTriggers();
+}
+
+// collects what is printed, e.g. a payload
+struct StringPrint : Print
+{
+  std::string s;
+  size_t write(uint8_t c) override
+  {
+    s += (char)c;
+    return 1;
+  }
+  using Print::write;
+};
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Minimal host stand-in for the STM32duino core, just what the library uses.
+// Time only moves when a test moves it, interrupts are fired by the test.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 3
+#define HEX 16
+#define DEC 10
+#define PA7 7
+
+typedef uint8_t byte;
+
+extern uint32_t mock_millis;
+extern uint32_t mock_micros;
+inline uint32_t millis() { return mock_millis; }
+inline uint32_t micros() { return mock_micros; }
+inline void delay(uint32_t ms) { mock_millis += ms; mock_micros += ms * 1000; }
+inline void delayMicroseconds(uint32_t us) { mock_micros += us; }
+
+inline void pinMode(uint32_t, uint32_t) {}
+inline void digitalWrite(uint32_t, uint32_t) {}
+
+// pin interrupts are kept so that a test can fire them with mock_pin_interrupt(),
+// inputs read HIGH unless a test pulls them low
+#define MOCK_PIN_COUNT 64
+extern bool mock_pin_low[MOCK_PIN_COUNT];
+inline int digitalRead(uint32_t pin) { return pin < MOCK_PIN_COUNT && mock_pin_low[pin] ? LOW : HIGH; }
+extern void (*mock_pin_isr[MOCK_PIN_COUNT])(void);
+inline uint32_t digitalPinToInterrupt(uint32_t pin) { return pin; }
+inline void attachInterrupt(uint32_t pin, void (*isr)(void), int) { mock_pin_isr[pin] = isr; }
+inline void detachInterrupt(uint32_t pin) { mock_pin_isr[pin] = nullptr; }
+inline void mock_pin_interrupt(uint32_t pin) { if (mock_pin_isr[pin]) mock_pin_isr[pin](); }
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+inline char *dtostrf(double value, signed char width, unsigned char precision, char *s)
+{
+  sprintf(s, "%*.*f", width, precision, value);
+  return s;
+}
+
+class String
+{
+public:
+  String(const char *s = "") { strncpy(_b, s, sizeof(_b) - 1); }
+  String &operator+=(const char *s) { strncat(_b, s, sizeof(_b) - strlen(_b) - 1); return *this; }
+  const char *c_str() const { return _b; }
+  unsigned length() const { return strlen(_b); }
+
+private:
+  char _b[1024] = {0};
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  virtual void flush() {}
+  virtual int availableForWrite() { return 0; }
+
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(long v, int base = DEC) { char t[24]; sprintf(t, base == HEX ? "%lx" : "%ld", v); return write(t); }
+  size_t print(int v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(unsigned long v, int base = DEC) { char t[24]; sprintf(t, base == HEX ? "%lx" : "%lu", v); return write(t); }
+  size_t print(double v, int digits = 2) { char t[48]; snprintf(t, sizeof(t), "%.*f", digits, v); return write(t); }
+  size_t println() { return write("\r\n"); }
+  template <class T> size_t println(T v) { return print(v) + println(); }
+  template <class T> size_t println(T v, int x) { return print(v, x) + println(); }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() { return -1; }
+};
+
+typedef int PinName;
+#define NP 0
+typedef struct
+{
+  PinName pin;
+  void *peripheral;
+  int function;
+} PinMap;
+extern const PinMap PinMap_TIM[];
+// every pin is routed to the same timer, none (nullptr) by default
+extern void *mock_pin_timer;
+extern uint32_t mock_pin_timer_channel;
+inline PinName digitalPinToPinName(uint32_t p) { return (PinName)p; }
+inline void *pinmap_peripheral(PinName, const PinMap *) { return mock_pin_timer; }
+inline uint32_t pinmap_function(PinName, const PinMap *) { return mock_pin_timer_channel; }
+#define STM_PIN_CHANNEL(f) ((f) & 0x1F)
+
+// flash of a STM32G031x8: 32 pages of 2 KB
+#define FLASH_PAGE_NB 32
+#define FLASH_PAGE_SIZE 2048
+#define FLASH_BASE 0x08000000UL
+#define FLASH_TYPEERASE_PAGES 0
+#define FLASH_BANK_1 1
+#define FLASH_TYPEPROGRAM_DOUBLEWORD 1
+typedef enum
+{
+  HAL_OK = 0,
+  HAL_ERROR
+} HAL_StatusTypeDef;
+typedef struct
+{
+  uint32_t TypeErase, Banks, Page, NbPages;
+} FLASH_EraseInitTypeDef;
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *, uint32_t *);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t, uint32_t, uint64_t);
+inline void HAL_FLASH_Unlock() {}
+inline void HAL_FLASH_Lock() {}
+typedef struct
+{
+  volatile uint32_t ECCR;
+} FLASH_TypeDef;
+extern FLASH_TypeDef *FLASH;
+#define FLASH_FLAG_ECCD (1UL << 31)
+#define __HAL_FLASH_GET_FLAG(flag) ((FLASH->ECCR & (flag)) != 0)
+#define __HAL_FLASH_CLEAR_FLAG(flag) (FLASH->ECCR &= ~(flag))
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Host stand-in for the STM32duino HardwareTimer: attached callbacks are kept so that
+// a test can fire them, the counter and the captured value are set by the test.
+
+#pragma once
+#include "Arduino.h"
+
+typedef struct
+{
+  int unused;
+} TIM_TypeDef;
+extern TIM_TypeDef *TIM3;
+extern TIM_TypeDef *TIM14;
+extern TIM_TypeDef *LPTIM1;
+
+typedef struct
+{
+  int unused;
+} TIM_HandleTypeDef;
+typedef struct
+{
+  uint32_t SlaveMode, InputTrigger, TriggerPolarity, TriggerPrescaler, TriggerFilter;
+} TIM_SlaveConfigTypeDef;
+#define TIM_SLAVEMODE_EXTERNAL1 7
+#define TIM_TS_TI1FP1 1
+#define TIM_TS_TI2FP2 2
+#define TIM_TRIGGERPOLARITY_RISING 0
+inline int HAL_TIM_SlaveConfigSynchro(TIM_HandleTypeDef *, TIM_SlaveConfigTypeDef *) { return 0; }
+
+#define TICK_FORMAT 0
+#define HERTZ_FORMAT 1
+#define MICROSEC_FORMAT 2
+enum
+{
+  TIMER_INPUT_CAPTURE_RISING = 1,
+  TIMER_INPUT_CAPTURE_FALLING,
+  TIMER_DISABLED
+};
+
+#define MOCK_TIMER_CHANNELS 5
+
+// a capture already flagged when its interrupt is attached, e.g. a spinning rotor at start up:
+// the callback runs as soon as it is attached, like the NVIC would do
+extern bool mock_capture_pending;
+
+class HardwareTimer
+{
+public:
+  HardwareTimer(TIM_TypeDef *instance) : instance(instance) {}
+  void setOverflow(uint32_t value, int = TICK_FORMAT) { overflow = value; }
+  void setPrescaleFactor(uint32_t) {}
+  void setMode(uint32_t, int, uint32_t = 0) {}
+  void attachInterrupt(void (*callback)(void)) { update_callback = callback; }
+  void attachInterrupt(uint32_t channel, void (*callback)(void))
+  {
+    channel_callback[channel] = callback;
+    if (mock_capture_pending)
+    {
+      mock_capture_pending = false;
+      callback();
+    }
+  }
+  void detachInterrupt() { update_callback = nullptr; }
+  void resume() { running = true; }
+  void pause() { running = false; }
+  void refresh() {}
+  uint32_t getCount(int = TICK_FORMAT) { return count; }
+  void setCount(uint32_t value, int = TICK_FORMAT) { count = value; }
+  uint32_t getCaptureCompare(uint32_t channel, int = TICK_FORMAT) { return capture[channel]; }
+  uint32_t getTimerClkFreq() { return 16000000; }
+  TIM_HandleTypeDef *getHandle() { return &handle; }
+
+  // test side: a capture event on channel, or the update event
+  void fireCapture(uint32_t channel, uint32_t value)
+  {
+    capture[channel] = value;
+    if (channel_callback[channel]) channel_callback[channel]();
+  }
+  void fireUpdate()
+  {
+    if (update_callback) update_callback();
+  }
+
+  TIM_TypeDef *instance;
+  TIM_HandleTypeDef handle = {0};
+  uint32_t overflow = 0;
+  volatile uint32_t count = 0;
+  volatile uint32_t capture[MOCK_TIMER_CHANNELS] = {0};
+  void (*update_callback)(void) = nullptr;
+  void (*channel_callback[MOCK_TIMER_CHANNELS])(void) = {nullptr};
+  bool running = false;
+};
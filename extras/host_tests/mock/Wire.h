@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Host stand-in for the Arduino Wire library: every transfer succeeds and reads return 0,
+// unless a test sets mock_i2c_device. Transfers then go to that device model and move micros()
+// by the bus time of their bytes at the clock set with setClock().
+
+#pragma once
+#include "Arduino.h"
+
+// a device on the bus, seen one transaction at a time
+struct MockI2cDevice
+{
+  virtual uint8_t write(const uint8_t *data, size_t length) = 0; // endTransmission() status, 0 when acknowledged
+  virtual size_t read(uint8_t *data, size_t length) = 0;         // bytes given
+};
+extern MockI2cDevice *mock_i2c_device;
+
+class TwoWire
+{
+public:
+  void begin() {}
+  void end() {}
+  void setSDA(uint32_t) {}
+  void setSCL(uint32_t) {}
+  void setClock(uint32_t clock) { _clock = clock; }
+  void beginTransmission(uint8_t) { _tx_length = 0; }
+  size_t write(uint8_t data)
+  {
+    if (_tx_length < sizeof(_tx))
+      _tx[_tx_length++] = data;
+    return 1;
+  }
+  uint8_t endTransmission(bool = true)
+  {
+    if (!mock_i2c_device)
+      return 0;
+    busTime(_tx_length);
+    return mock_i2c_device->write(_tx, _tx_length);
+  }
+  uint8_t requestFrom(uint8_t, size_t length)
+  {
+    if (!mock_i2c_device)
+      return length;
+    if (length > sizeof(_rx))
+      length = sizeof(_rx);
+    _rx_length = mock_i2c_device->read(_rx, length);
+    _rx_pos = 0;
+    busTime(length);
+    return _rx_length;
+  }
+  int available() { return mock_i2c_device ? _rx_length - _rx_pos : 1; }
+  int read() { return mock_i2c_device ? (_rx_pos < _rx_length ? _rx[_rx_pos++] : -1) : 0; }
+
+private:
+  // start, address byte, data bytes with their acknowledge bit, stop
+  void busTime(size_t bytes) { mock_micros += (uint32_t)((2 + 9 * (bytes + 1)) * 1000000ULL / _clock); }
+
+  uint32_t _clock = 100000;
+  uint8_t _tx[32];
+  size_t _tx_length = 0;
+  uint8_t _rx[32];
+  size_t _rx_length = 0;
+  size_t _rx_pos = 0;
+};
+extern TwoWire Wire;
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Globals of the host mocks. Flash operations succeed without storing anything:
+// tests of the wind log replace the wn_flash_* layer with an emulator instead.
+
+#include "Arduino.h"
+#include "HardwareTimer.h"
+#include "Wire.h"
+
+uint32_t mock_millis = 0;
+uint32_t mock_micros = 0;
+void (*mock_pin_isr[MOCK_PIN_COUNT])(void) = {nullptr};
+bool mock_pin_low[MOCK_PIN_COUNT] = {false};
+
+static TIM_TypeDef tim3, tim14, lptim1;
+TIM_TypeDef *TIM3 = &tim3;
+TIM_TypeDef *TIM14 = &tim14;
+TIM_TypeDef *LPTIM1 = &lptim1;
+const PinMap PinMap_TIM[] = {{NP, nullptr, 0}};
+void *mock_pin_timer = nullptr;
+uint32_t mock_pin_timer_channel = 0;
+bool mock_capture_pending = false;
+
+static FLASH_TypeDef flash;
+FLASH_TypeDef *FLASH = &flash;
+// linker script symbols bounding the image, the real wn_flash_* layer cannot run on the host anyway
+extern "C"
+{
+  uint32_t _sidata = 0, _sdata = 0, _edata = 0;
+}
+
+TwoWire Wire;
+MockI2cDevice *mock_i2c_device = nullptr;
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *, uint32_t *)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t, uint32_t, uint64_t)
+{
+  return HAL_OK;
+}
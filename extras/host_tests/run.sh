@@ -0,0 +1,47 @@
+#!/bin/sh
+#
+# Copyright (c) 2026, windnerd.net
+# All rights reserved.
+#
+# This source code is licensed under the BSD 3-Clause License found in the
+# LICENSE file in the root directory of this source tree.
+#
+# Builds the library against the host mocks and runs the host tests.
+# Usage: run.sh [test_name ...]   (all test_*.cpp by default, bench_*.cpp only when named)
+# A test links its own definitions first, so it can replace any library function,
+# e.g. the wn_flash_* layer, or include a library .cpp to reach its static functions.
+
+set -e
+here=$(cd "$(dirname "$0")" && pwd)
+src="$here/../../src"
+build="${BUILD_DIR:-$here/build}"
+cxx="${CXX:-g++}"
+# optional features on, so that their tests run
+features="-DWIND_SPEED_PERCENTILES=1 -DWIND_EXTENDED_STATISTICS=1 -DWIND_ROSE=1"
+flags="-std=gnu++17 -O2 -g -Wall -Wextra -Wno-unused-parameter -Wno-missing-field-initializers -Werror -Wno-unused-function $features -I$here/mock -I$here -I$src -pthread"
+
+mkdir -p "$build/lib"
+rm -f "$build/libwindnerd.a"
+for f in "$src"/*.cpp "$here"/mock/*.cpp; do
+  $cxx $flags -c "$f" -o "$build/lib/$(basename "$f" .cpp).o"
+done
+ar rcs "$build/libwindnerd.a" "$build"/lib/*.o
+
+if [ $# -eq 0 ]; then
+  set -- $(cd "$here" && ls test_*.cpp | sed 's/\.cpp$//')
+fi
+
+failed=""
+for name in "$@"; do
+  name=${name%.cpp}
+  $cxx $flags "$here/$name.cpp" "$build/libwindnerd.a" -o "$build/$name"
+  if ! (cd "$here" && "$build/$name"); then
+    failed="$failed $name"
+  fi
+done
+
+if [ -n "$failed" ]; then
+  echo "FAILED:$failed"
+  exit 1
+fi
+echo "ALL PASSED"
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Checks for the host tests: a failed CHECK prints where and why, TEST_END() sets the exit status.
+
+#pragma once
+#include <stdio.h>
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+#define CHECK(condition)                                                     \
+  do                                                                         \
+  {                                                                          \
+    test_checks++;                                                           \
+    if (!(condition))                                                        \
+    {                                                                        \
+      test_failures++;                                                       \
+      if (test_failures <= 20)                                               \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+    }                                                                        \
+  } while (0)
+
+#define CHECK_EQUAL_STRING(actual, expected)                                                     \
+  do                                                                                             \
+  {                                                                                              \
+    test_checks++;                                                                               \
+    if (strcmp((actual), (expected)) != 0)                                                       \
+    {                                                                                            \
+      test_failures++;                                                                           \
+      if (test_failures <= 20)                                                                   \
+        printf("%s:%d: got \"%s\", expected \"%s\"\n", __FILE__, __LINE__, (actual), (expected)); \
+    }                                                                                            \
+  } while (0)
+
+#define TEST_END()                                                                              \
+  do                                                                                            \
+  {                                                                                             \
+    printf("%s: %d checks, %d failed\n", __FILE__, test_checks, test_failures);                 \
+    return test_failures == 0 ? 0 : 1;                                                          \
+  } while (0)
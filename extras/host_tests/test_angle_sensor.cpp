@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// TMAG5273 driver against a register model of the sensor on the mock I2C bus: the blocking read
+// next to the start/poll conversion used by WN_Core::loop(), with the time the MCU stays awake per vane tick.
+
+#include "test.h"
+#include "Wire.h"
+#include "Windnerd_TMAG5273.h"
+
+#define INT_PIN 9
+
+// registers and modes used by the driver, see Windnerd_TMAG5273.cpp
+#define DEVICE_CONFIG_2 0x01
+#define INT_CONFIG_1 0x08
+#define ANGLE_RESULT_MSB 0x19
+#define MODE_SLEEP 1
+#define MODE_MEASURE 2
+#define INT_ON_RESULT_VIA_INT_PIN 0b10000100
+
+// Wakes up on a transaction when asleep, is ready wake_us later, then converts for conversion_us once put in
+// measure mode. The result register holds the angle in 1/16 degree, INT goes low at the end of the conversion
+// when enabled and is released when the result is read.
+struct Tmag5273Model : MockI2cDevice
+{
+  uint32_t wake_us = 1000;
+  uint32_t conversion_us = 10000;
+  uint16_t angle = 0; // degrees
+
+  uint8_t registers[0x20] = {0};
+  uint8_t pointer = 0;
+  bool asleep = true;
+  uint32_t ready_at = 0;
+  bool converting = false;
+  uint32_t result_at = 0;
+  int early_commands = 0; // sent while still waking up
+  int stale_reads = 0;    // result read before the end of the conversion
+  int results = 0;
+
+  void update()
+  {
+    if (converting && (int32_t)(mock_micros - result_at) >= 0)
+    {
+      converting = false;
+      results++;
+      uint16_t raw = angle * 16;
+      registers[ANGLE_RESULT_MSB] = raw >> 8;
+      registers[ANGLE_RESULT_MSB + 1] = raw & 0xFF;
+      mock_pin_low[INT_PIN] = registers[INT_CONFIG_1] == INT_ON_RESULT_VIA_INT_PIN;
+    }
+  }
+
+  uint8_t write(const uint8_t *data, size_t length) override
+  {
+    update();
+    if (asleep)
+    {
+      asleep = false;
+      ready_at = mock_micros + wake_us;
+    }
+    else if (length > 1 && (int32_t)(mock_micros - ready_at) < 0)
+    {
+      early_commands++;
+    }
+    if (length == 0)
+      return 0;
+    pointer = data[0];
+    if (length > 1)
+    {
+      registers[pointer] = data[1];
+      if (pointer == DEVICE_CONFIG_2 && (data[1] & 3) == MODE_MEASURE)
+      {
+        converting = true;
+        result_at = mock_micros + conversion_us;
+      }
+      if (pointer == DEVICE_CONFIG_2 && (data[1] & 3) == MODE_SLEEP)
+      {
+        asleep = true;
+        converting = false;
+      }
+    }
+    return 0;
+  }
+
+  size_t read(uint8_t *data, size_t length) override
+  {
+    update();
+    if (pointer == ANGLE_RESULT_MSB)
+    {
+      if (converting || results == 0)
+        stale_reads++;
+      mock_pin_low[INT_PIN] = false;
+    }
+    for (size_t i = 0; i < length; i++)
+      data[i] = registers[(pointer + i) & 0x1F];
+    return length;
+  }
+};
+
+typedef struct
+{
+  uint32_t awake_us = 0; // in the driver, I2C transfers and delay()
+  uint32_t wakeups = 0;
+  uint32_t latency_us = 0; // from the vane tick to the angle
+  uint16_t angle = 0;
+} tick_t;
+
+static tick_t blockingTick()
+{
+  tick_t tick;
+  uint32_t start = mock_micros;
+  tick.angle = wn_read_then_make_angle_sensor_sleep();
+  tick.awake_us = tick.latency_us = mock_micros - start;
+  tick.wakeups = 1;
+  return tick;
+}
+
+// like WN_Core::loop(): the conversion starts on the vane tick, then loop() runs every millisecond
+// (nextWakeupMs() is 1 while a conversion is in progress) and polls it
+static tick_t pollingTick(Tmag5273Model &sensor)
+{
+  tick_t tick;
+  uint32_t start = mock_micros;
+  wn_start_angle_conversion();
+  tick.awake_us += mock_micros - start;
+  tick.wakeups = 1;
+  while (wn_is_angle_conversion_in_progress())
+  {
+    mock_micros += 1000;
+    mock_millis += 1;
+    sensor.update();
+    uint32_t wake = mock_micros;
+    wn_poll_angle_conversion(&tick.angle);
+    tick.awake_us += mock_micros - wake;
+    tick.wakeups++;
+  }
+  tick.latency_us = mock_micros - start;
+  return tick;
+}
+
+static void run(const char *name, bool int_pin, bool polling, uint32_t conversion_us)
+{
+  Tmag5273Model sensor;
+  sensor.conversion_us = conversion_us;
+  mock_i2c_device = &sensor;
+  wn_init_angle_sensor(1, 2, int_pin ? INT_PIN : NO_ANGLE_SENSOR_INT_PIN);
+  mock_micros += 5000;
+  // init writes the configuration right after the read that wakes the sensor, only vane ticks are checked here
+  sensor.early_commands = 0;
+
+  tick_t worst;
+  int wrong_angles = 0;
+  for (uint16_t angle = 0; angle < 360; angle++)
+  {
+    sensor.angle = angle;
+    tick_t tick = polling ? pollingTick(sensor) : blockingTick();
+    if (tick.angle != angle)
+      wrong_angles++;
+    worst.awake_us = std::max(worst.awake_us, tick.awake_us);
+    worst.wakeups = std::max(worst.wakeups, tick.wakeups);
+    worst.latency_us = std::max(worst.latency_us, tick.latency_us);
+    mock_micros += 500000; // next vane tick
+    mock_millis += 500;
+    sensor.update();
+  }
+  CHECK(wrong_angles == 0);
+  CHECK(sensor.early_commands == 0);
+  CHECK(sensor.stale_reads == 0);
+  CHECK(sensor.asleep);
+  CHECK(wn_get_last_angle_sensor_i2c_error() == 0);
+  mock_i2c_device = nullptr;
+  mock_pin_low[INT_PIN] = false;
+  printf("  %-28s conversion %2u ms: awake %5u us per tick in %2u wakeups, angle after %5.1f ms\n", name,
+         conversion_us / 1000, worst.awake_us, worst.wakeups, worst.latency_us / 1000.0);
+}
+
+int main()
+{
+  // bus at the Wire default of 100 kHz, the sensor model converts in 10 ms (the driver's budget) or 2 ms
+  run("blocking read (before)", false, false, 10000);
+  run("start/poll, timed (after)", false, true, 10000);
+  run("start/poll, INT pin (after)", true, true, 10000);
+  run("start/poll, INT pin (after)", true, true, 2000);
+  TEST_END();
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// WN_MODEM against a scripted fake modem, talking through a pair of pipes like a serial port.
+// Each scenario checks the final status, the HTTP status, acknowledgement, retries and the time awake.
+
+#include "test.h"
+#include "core_access.h"
+#define private public
+#include "Windnerd_Wtp_Payload.h"
+#undef private
+#include "Windnerd_Modem.h"
+#include <deque>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// serial port side of the driver: writes go to the modem, reads come from it
+struct PipeStream : Stream
+{
+  int rx_fd, tx_fd;
+  size_t write(uint8_t c) override { return ::write(tx_fd, &c, 1) == 1 ? 1 : 0; }
+  size_t write(const uint8_t *buffer, size_t size) override
+  {
+    ssize_t n = ::write(tx_fd, buffer, size);
+    return n > 0 ? n : 0;
+  }
+  using Print::write;
+  int available() override
+  {
+    int n = 0;
+    ioctl(rx_fd, FIONREAD, &n);
+    return n;
+  }
+  int read() override
+  {
+    uint8_t c;
+    return ::read(rx_fd, &c, 1) == 1 ? c : -1;
+  }
+};
+
+// answers each command line after response_ms, the +HTTPACTION result after action_ms
+struct FakeModem
+{
+  int rx_fd, tx_fd; // from and to the driver
+  int init_errors = 0;      // ERROR to that many AT+HTTPINIT
+  int lost_at = 0;          // AT commands ignored while waking up
+  bool dead = false;        // never answers
+  bool no_result = false;   // no +HTTPACTION after AT+HTTPACTION
+  int http_status = 200;
+  uint32_t response_ms = 20;
+  uint32_t action_ms = 1500;
+
+  std::string line, body, commands;
+  long body_expected = -1;
+  int posts = 0;
+  std::string last_body;
+  long last_declared = -1;
+  std::deque<std::pair<uint32_t, std::string>> answers;
+
+  void say(uint32_t delay_ms, const std::string &text)
+  {
+    uint32_t at = mock_millis + delay_ms;
+    if (!answers.empty() && answers.back().first > at) at = answers.back().first;
+    answers.push_back({at, text});
+  }
+
+  void command(const std::string &cmd)
+  {
+    commands += cmd + "|";
+    if (dead) return;
+    if (cmd == "AT" && lost_at > 0)
+    {
+      lost_at--;
+      return;
+    }
+    say(response_ms, cmd + "\r\n"); // echo
+    if (cmd == "AT+HTTPINIT" && init_errors > 0)
+    {
+      init_errors--;
+      say(response_ms, "ERROR\r\n");
+      return;
+    }
+    if (cmd.rfind("AT+HTTPDATA=", 0) == 0)
+    {
+      body_expected = last_declared = atol(cmd.c_str() + 12);
+      say(response_ms, "DOWNLOAD\r\n");
+      return;
+    }
+    if (cmd == "AT+HTTPACTION=1")
+    {
+      posts++;
+      say(response_ms, "OK\r\n");
+      if (!no_result) say(action_ms, "\r\n+HTTPACTION: 1," + std::to_string(http_status) + ",2\r\n");
+      return;
+    }
+    say(response_ms, "OK\r\n");
+  }
+
+  // what the driver wrote so far, then the answers that are due
+  void poll()
+  {
+    char buffer[512];
+    ssize_t n;
+    while ((n = ::read(rx_fd, buffer, sizeof(buffer))) > 0)
+    {
+      for (ssize_t i = 0; i < n; i++)
+      {
+        char c = buffer[i];
+        if (body_expected >= 0)
+        {
+          body += c;
+          if ((long)body.size() == body_expected)
+          {
+            body_expected = -1;
+            last_body = body;
+            body.clear();
+            say(response_ms, "\r\nOK\r\n");
+          }
+        }
+        else if (c == '\n')
+        {
+          if (!line.empty() && line.back() == '\r') line.pop_back();
+          command(line);
+          line.clear();
+        }
+        else
+        {
+          line += c;
+        }
+      }
+    }
+    while (!answers.empty() && answers.front().first <= mock_millis)
+    {
+      const std::string &text = answers.front().second;
+      CHECK(::write(tx_fd, text.data(), text.size()) == (ssize_t)text.size());
+      answers.pop_front();
+    }
+  }
+};
+
+struct Link
+{
+  PipeStream serial;
+  FakeModem modem;
+  Link()
+  {
+    int to_modem[2], to_driver[2];
+    CHECK(pipe(to_modem) == 0 && pipe(to_driver) == 0);
+    for (int fd : {to_modem[0], to_driver[0]}) fcntl(fd, F_SETFL, O_NONBLOCK);
+    serial.tx_fd = to_modem[1];
+    serial.rx_fd = to_driver[0];
+    modem.rx_fd = to_modem[0];
+    modem.tx_fd = to_driver[1];
+  }
+  ~Link()
+  {
+    close(serial.tx_fd);
+    close(serial.rx_fd);
+    close(modem.rx_fd);
+    close(modem.tx_fd);
+  }
+};
+
+static size_t count(const std::string &text, const std::string &what)
+{
+  size_t n = 0;
+  for (size_t pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + 1)) n++;
+  return n;
+}
+
+struct Result
+{
+  wn_modem_status_t status;
+  int http_status;
+  uint32_t awake_ms;
+  bool acknowledged;
+};
+
+static WN_Core core;
+static WN_WTP_PAYLOAD payload;
+
+// one incremental post of the samples added since the previous scenario
+static Result post(Link &link, uint32_t budget_ms = 60000)
+{
+  for (int i = 0; i < 40; i++) feedSample(core, (i * 37) % 100, (i * 53) % 360);
+  payload.reset();
+  payload.setAnemometer(&core);
+  payload.setSecretKey((char *)"3122fd880084fd55");
+  payload.enableWindSamples();
+  uint32_t acked = payload._acked_sample_end;
+
+  WN_MODEM modem(&link.serial);
+  modem.setRetries(2);
+  modem.setAwakeBudgetMs(budget_ms);
+  CHECK(modem.post(&payload));
+  uint32_t start = mock_millis;
+  while (modem.isBusy() && mock_millis - start < 200000)
+  {
+    mock_millis++;
+    link.modem.poll();
+    modem.loop();
+  }
+  CHECK(!modem.isBusy());
+  return {modem.getStatus(), modem.getHttpStatus(), modem.getAwakeMs(), payload._acked_sample_end != acked};
+}
+
+int main()
+{
+  payload.enableIncrementalUpload();
+
+  {
+    Link link;
+    Result r = post(link);
+    CHECK(r.status == MODEM_DONE && r.http_status == 200 && r.acknowledged);
+    CHECK(link.modem.posts == 1);
+    CHECK((long)link.modem.last_body.size() == link.modem.last_declared);
+    CHECK(link.modem.last_body.find("s,wi=") != std::string::npos);
+    CHECK(count(link.modem.commands, "AT+HTTPTERM") == 2);
+    printf("  nominal post: %u ms awake, %zu bytes\n", r.awake_ms, link.modem.last_body.size());
+  }
+  {
+    // any 2xx is a success
+    Link link;
+    link.modem.http_status = 204;
+    Result r = post(link);
+    CHECK(r.status == MODEM_DONE && r.http_status == 204 && r.acknowledged);
+  }
+  {
+    Link link;
+    link.modem.http_status = 500;
+    Result r = post(link);
+    CHECK(r.status == MODEM_FAILED && r.http_status == 500 && !r.acknowledged);
+    CHECK(link.modem.posts == 1);
+  }
+  {
+    Link link;
+    link.modem.http_status = 302;
+    Result r = post(link);
+    CHECK(r.status == MODEM_FAILED && r.http_status == 302 && !r.acknowledged);
+  }
+  {
+    // the backlog of the failed posts goes with the next one
+    Link link;
+    Result r = post(link);
+    CHECK(r.status == MODEM_DONE && r.acknowledged);
+    CHECK(!payload.hasBacklog());
+  }
+  {
+    Link link;
+    link.modem.init_errors = 1;
+    Result r = post(link);
+    CHECK(r.status == MODEM_DONE && r.acknowledged);
+    CHECK(count(link.modem.commands, "AT+HTTPINIT|") == 2);
+  }
+  {
+    Link link;
+    link.modem.init_errors = 5;
+    Result r = post(link);
+    CHECK(r.status == MODEM_FAILED && !r.acknowledged);
+    CHECK(count(link.modem.commands, "AT+HTTPINIT|") == 3);
+    CHECK(link.modem.posts == 0);
+  }
+  {
+    // the first AT is lost while the modem wakes up, retried after MODEM_AT_TIMEOUT_MS
+    Link link;
+    link.modem.lost_at = 1;
+    Result r = post(link);
+    CHECK(r.status == MODEM_DONE && r.acknowledged);
+    CHECK(r.awake_ms >= MODEM_AT_TIMEOUT_MS && r.awake_ms < MODEM_AT_TIMEOUT_MS + 2000);
+  }
+  {
+    // no result after the post: timeout, never posted twice
+    Link link;
+    link.modem.no_result = true;
+    Result r = post(link);
+    CHECK(r.status == MODEM_FAILED && !r.acknowledged);
+    CHECK(link.modem.posts == 1);
+    CHECK(r.awake_ms >= MODEM_ACTION_TIMEOUT_MS && r.awake_ms < MODEM_ACTION_TIMEOUT_MS + MODEM_COMMAND_TIMEOUT_MS + 1000);
+  }
+  {
+    // silent modem: AT is tried 3 times
+    Link link;
+    link.modem.dead = true;
+    Result r = post(link);
+    CHECK(r.status == MODEM_FAILED && !r.acknowledged);
+    CHECK(count(link.modem.commands, "AT|") == 3);
+    CHECK(r.awake_ms >= 3 * MODEM_AT_TIMEOUT_MS && r.awake_ms <= 3 * MODEM_AT_TIMEOUT_MS + 10);
+    printf("  dead modem: failed after %u ms\n", r.awake_ms);
+  }
+  {
+    Link link;
+    link.modem.response_ms = 200;
+    link.modem.action_ms = 4000;
+    Result r = post(link);
+    CHECK(r.status == MODEM_DONE && r.acknowledged);
+    printf("  slow modem: %u ms awake\n", r.awake_ms);
+  }
+  {
+    // the awake budget bounds the whole exchange
+    Link link;
+    link.modem.no_result = true;
+    Result r = post(link, 10000);
+    CHECK(r.status == MODEM_FAILED && !r.acknowledged);
+    CHECK(r.awake_ms >= 10000 && r.awake_ms <= 10010);
+  }
+  {
+    Link link;
+    WN_MODEM modem(&link.serial);
+    CHECK(modem.command("AT+CSCLK=2"));
+    while (modem.isBusy())
+    {
+      mock_millis++;
+      link.modem.poll();
+      modem.loop();
+    }
+    CHECK(modem.getStatus() == MODEM_DONE);
+    CHECK(link.modem.commands == "AT+CSCLK=2|");
+  }
+  TEST_END();
+}
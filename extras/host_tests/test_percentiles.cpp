@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Speed percentiles from the sliding histogram against an exact sort of the window: exact below
+// HISTOGRAM_LINEAR_BUCKETS pulses, within the bucket width (1/8 of the value) above.
+
+#include "test.h"
+#define private public
+#include "Windnerd_Rolling_Buffer.cpp"
+#undef private
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+// interpolated between the two samples around the position, like numpy and spreadsheets
+static double exactPercentile(std::vector<double> values, double percent)
+{
+  std::sort(values.begin(), values.end());
+  double position = percent / 100 * (values.size() - 1);
+  size_t rank = (size_t)position;
+  if (rank + 1 >= values.size()) return values.back();
+  return values[rank] + (values[rank + 1] - values[rank]) * (position - rank);
+}
+
+// every pulse count falls in the bucket whose range holds it
+static void testBuckets()
+{
+  int errors = 0;
+  uint8_t previous = 0;
+  for (uint32_t pulses = 0; pulses <= PACKED_SAMPLE_MAX_PULSES; pulses++)
+  {
+    uint8_t bucket = histogramBucket(pulses);
+    uint8_t shift;
+    uint16_t start = histogramBucketStart(bucket, &shift);
+    if (bucket >= HISTOGRAM_BUCKETS || pulses < start || pulses >= start + (1u << shift) || bucket < previous) errors++;
+    // the width of a bucket is at most 1/8 of its start, which bounds the relative error
+    if (shift > 0 && (1u << shift) * HISTOGRAM_BUCKETS_PER_OCTAVE > start) errors++;
+    previous = bucket;
+  }
+  CHECK(errors == 0);
+  CHECK(histogramBucket(HISTOGRAM_LINEAR_BUCKETS - 1) == HISTOGRAM_LINEAR_BUCKETS - 1);
+  CHECK(histogramBucket(PACKED_SAMPLE_MAX_PULSES) == HISTOGRAM_BUCKETS - 1);
+}
+
+static void testAgainstSort()
+{
+  std::mt19937 random(7);
+  const double ms_per_pulse = 1.31 / 3;
+  const char *names[] = {"Weibull k=2, mean 6 m/s", "storm 12 m/s with gusts", "light air 0-3 m/s", "ramp 0-40 m/s", "any pulse count"};
+  for (int kind = 0; kind < 5; kind++)
+  {
+    for (int window : {20, 200, 400, 800})
+    {
+      WN_ROLLINGBUFFER buffer;
+      buffer.setExtremesWindow(window);
+      std::vector<double> stored;
+      std::weibull_distribution<double> weibull(2, 6.77);
+      std::normal_distribution<double> normal(0, 1);
+      double ar = 0, worst_ms = 0, worst_relative = 0;
+      int inexact_low = 0, beyond_bound = 0;
+      for (int i = 0; i < 3000; i++)
+      {
+        double ms;
+        if (kind == 0) ms = weibull(random);
+        else if (kind == 1) ms = std::max(0.0, 12 + (ar = 0.9 * ar + normal(random) * 1.3) + (random() % 50 == 0 ? 8 : 0));
+        else if (kind == 2) ms = fabs(normal(random)) * 1.2;
+        else if (kind == 3) ms = std::max(0.0, 40.0 * i / 3000 + normal(random));
+        else ms = (random() % (PACKED_SAMPLE_MAX_PULSES + 1)) * ms_per_pulse;
+        uint16_t pulses = (uint16_t)std::min<long>(lround(ms / ms_per_pulse), PACKED_SAMPLE_MAX_PULSES);
+        wn_raw_wind_sample_t sample = {pulses, (uint16_t)(random() % 360), true};
+        buffer.addRawSample(sample);
+        stored.push_back(pulses);
+
+        std::vector<double> in_window(stored.end() - std::min<size_t>(stored.size(), window), stored.end());
+        for (double percent : {0.0, 10.0, 50.0, 75.0, 90.0, 99.0, 100.0})
+        {
+          double exact = exactPercentile(in_window, percent);
+          double got = buffer.getWindowPulsesPercentile(percent);
+          double error = fabs(got - exact);
+          // the samples around the percentile both below the log buckets: exact
+          double above = in_window.size() > 1 ? exactPercentile(in_window, std::min(100.0, percent + 100.0 / (in_window.size() - 1))) : exact;
+          if (above < HISTOGRAM_LINEAR_BUCKETS && error > 1e-3) inexact_low++;
+          if (error > exact / HISTOGRAM_BUCKETS_PER_OCTAVE + 1e-3) beyond_bound++;
+          worst_ms = std::max(worst_ms, error * ms_per_pulse);
+          if (exact > 0) worst_relative = std::max(worst_relative, error / exact);
+        }
+      }
+      CHECK(inexact_low == 0);
+      CHECK(beyond_bound == 0);
+      if (window == 800)
+        printf("  %-24s window %d: worst error %.2f m/s, %.1f%%\n", names[kind], window, worst_ms, worst_relative * 100);
+    }
+  }
+}
+
+static void benchmark()
+{
+  std::mt19937 random(1);
+  WN_ROLLINGBUFFER buffer;
+  buffer.setExtremesWindow(200);
+  for (int i = 0; i < 1000; i++)
+  {
+    wn_raw_wind_sample_t sample = {(uint16_t)(random() % 80), 0, true};
+    buffer.addRawSample(sample);
+  }
+  const int queries = 100000;
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < queries; i++) sink += buffer.getWindowPulsesPercentile(90);
+  printf("  percentile query: %.0f ns on this host\n",
+         std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / queries);
+}
+
+int main()
+{
+  testBuckets();
+  testAgainstSort();
+  benchmark();
+  TEST_END();
+}
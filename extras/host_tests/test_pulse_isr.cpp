@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Speed pulse interrupts against the loop: a capture pending when its interrupt is attached,
+// interrupts fired from another thread while the loop reads, 16 and 32 bits wraparounds,
+// an overrun capture ring, rotor stops longer than the capture period and bounces.
+
+#include "test.h"
+#define private public
+#include "Windnerd_Core.cpp"
+#undef private
+#include <atomic>
+#include <random>
+#include <thread>
+
+static TIM_TypeDef capture_instance;
+
+static void resetIsrState()
+{
+  isr_pulse_total = 0;
+  last_isr_pulse_total = 0;
+  window_pulse_count = 0;
+  isr_period_head = 0;
+  period_tail = 0;
+  has_last_capture = false;
+  pulseCaptureTimer = nullptr;
+  mock_pin_timer = &capture_instance;
+  mock_pin_timer_channel = 2;
+  mock_millis = 1000;
+}
+
+static WN_Core *startCore(wn_pulse_counting_t counting)
+{
+  WN_Core *core = new WN_Core(CORE_SPEED_LED_PIN, CORE_NORTH_LED_PIN, CORE_SPEED_INPUT_PIN, CORE_SCL_PIN, CORE_SDA_PIN, counting);
+  core->begin();
+  return core;
+}
+
+// the rotor was spinning at start up: the capture interrupt runs as soon as it is attached
+static void testPendingCaptureAtStart()
+{
+  resetIsrState();
+  mock_capture_pending = true;
+  WN_Core *core = startCore(PULSE_COUNTING_CAPTURE);
+  CHECK(core->getPulseCounting() == PULSE_COUNTING_CAPTURE);
+  CHECK(!mock_capture_pending);
+  CHECK(isr_pulse_total == 1);
+  CHECK(has_last_capture);
+
+  // without a timer on the pin, capture falls back to pulse interrupts
+  resetIsrState();
+  mock_pin_timer = nullptr;
+  WN_Core *fallback = startCore(PULSE_COUNTING_CAPTURE);
+  CHECK(fallback->getPulseCounting() == PULSE_COUNTING_INTERRUPT);
+  mock_pin_interrupt(CORE_SPEED_INPUT_PIN);
+  CHECK(isr_pulse_total == 1);
+}
+
+// what the loop took from the ring so far, the window counters are emptied so they can't overflow
+struct Taken
+{
+  uint64_t periods = 0;
+  uint64_t sum = 0;
+  uint16_t min = UINT16_MAX;
+  uint64_t pulses = 0;
+};
+
+static void take(WN_Core *core, Taken &taken)
+{
+  core->readPulseCounter();
+  taken.periods += core->_window_periods;
+  taken.sum += core->_window_period_sum;
+  if (core->_window_min_period < taken.min) taken.min = core->_window_min_period;
+  taken.pulses += window_pulse_count;
+  core->_window_periods = 0;
+  core->_window_period_sum = 0;
+  core->_window_min_period = UINT16_MAX;
+  window_pulse_count = 0;
+}
+
+// the capture interrupt fired from another thread while the loop reads the ring:
+// every period must be read once and unchanged, captured ticks wrap around 16 bits many times
+static void testConcurrentCaptureAndRead()
+{
+  resetIsrState();
+  WN_Core *core = startCore(PULSE_COUNTING_CAPTURE);
+  HardwareTimer *timer = pulseCaptureTimer;
+  CHECK(timer != nullptr);
+  if (!timer) return;
+
+  const int pulses = 50000;
+  std::atomic<bool> done{false};
+  uint64_t injected_sum = 0;
+  uint16_t injected_min = UINT16_MAX;
+  std::thread isr([&] {
+    std::mt19937 random(3);
+    uint32_t ticks = 0;
+    for (int i = 0; i < pulses; i++)
+    {
+      // the ring is sized for the loop period, the producer waits instead of overrunning it
+      while (isr_period_head - *(volatile uint32_t *)&period_tail >= CAPTURE_RING_LENGTH) std::this_thread::yield();
+      uint16_t period = CAPTURE_MIN_PERIOD_TICKS + random() % 20000;
+      ticks += period;
+      if (i > 0)
+      {
+        injected_sum += period;
+        if (period < injected_min) injected_min = period;
+      }
+      timer->fireCapture(mock_pin_timer_channel, ticks & 0xFFFF);
+    }
+    done = true;
+  });
+
+  Taken taken;
+  while (!done) take(core, taken);
+  isr.join();
+  take(core, taken);
+
+  CHECK(taken.pulses == (uint64_t)pulses);
+  CHECK(taken.periods == (uint64_t)pulses - 1);
+  CHECK(taken.sum == injected_sum);
+  CHECK(taken.min == injected_min);
+  printf("  %d captures, %llu periods read concurrently\n", pulses, (unsigned long long)taken.periods);
+}
+
+// pulse interrupts fired from another thread at random points of loop(), none may be lost
+static void testConcurrentPulsesAndLoop()
+{
+  resetIsrState();
+  mock_pin_timer = nullptr;
+  WN_Core *core = startCore(PULSE_COUNTING_INTERRUPT);
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> injected{0};
+  std::thread isr([&] {
+    std::mt19937 random(7);
+    while (!stop)
+    {
+      mock_pin_interrupt(CORE_SPEED_INPUT_PIN);
+      injected++;
+      for (volatile int i = random() % 400; i > 0; i--)
+        ;
+    }
+  });
+  for (int ms = 0; ms < 600000; ms++)
+  {
+    mock_millis++;
+    mock_micros += 1000;
+    onTickerTimerISR();
+    core->loop();
+  }
+  stop = true;
+  isr.join();
+
+  uint64_t stored = 0;
+  for (uint32_t i = 0; i < core->getSampleCount() && i < ROLLING_BUFFER_LENGTH; i++)
+  {
+    stored += core->getRawSampleIndexedFromLast(i).pulses;
+  }
+  uint64_t pending = window_pulse_count + (isr_pulse_total - last_isr_pulse_total);
+  // samples are normalized to 3 s, over whole windows the rounding is carried so the total is kept
+  int64_t lost = (int64_t)injected - (int64_t)(stored + pending);
+  CHECK(core->getSampleCount() == 200);
+  CHECK(lost >= -1 && lost <= 1);
+  printf("  %llu pulse interrupts during 200 samples, %lld lost\n", (unsigned long long)injected, (long long)lost);
+}
+
+static void testWraparounds()
+{
+  resetIsrState();
+  WN_Core *core = startCore(PULSE_COUNTING_CAPTURE);
+  Taken taken;
+
+  // 32 bits pulse total
+  isr_pulse_total = last_isr_pulse_total = 0xFFFFFFF0;
+  uint32_t ticks = 65000;
+  // and 16 bits captured ticks, 65000 + 30 x 1000
+  for (int i = 0; i < 30; i++)
+  {
+    ticks += 1000;
+    pulseCaptureTimer->fireCapture(mock_pin_timer_channel, ticks & 0xFFFF);
+  }
+  take(core, taken);
+  CHECK(isr_pulse_total == 0x0E);
+  CHECK(taken.pulses == 30);
+  CHECK(taken.periods == 29 && taken.sum == 29000 && taken.min == 1000);
+
+  // the loop was late: the oldest periods were overwritten and are skipped, the pulses are all counted
+  taken = Taken();
+  for (int i = 0; i < 100; i++)
+  {
+    ticks += 500 + i;
+    pulseCaptureTimer->fireCapture(mock_pin_timer_channel, ticks & 0xFFFF);
+  }
+  take(core, taken);
+  CHECK(taken.pulses == 100);
+  CHECK(taken.periods == CAPTURE_RING_LENGTH);
+  CHECK(taken.min == 500 + 100 - CAPTURE_RING_LENGTH);
+}
+
+static wn_instant_wind_sample_t last_sample;
+static int sample_callbacks = 0;
+static void onSample(wn_instant_wind_sample_t sample)
+{
+  last_sample = sample;
+  sample_callbacks++;
+}
+
+static void runLoop(WN_Core *core, uint32_t ms)
+{
+  for (uint32_t i = 0; i < ms; i++)
+  {
+    mock_millis++;
+    mock_micros += 1000;
+    onTickerTimerISR();
+    core->loop();
+  }
+}
+
+// a pulse after the rotor stopped longer than CAPTURE_MAX_PERIOD_MS only starts a new period,
+// windows without pulses give a null speed and gust, bounces are ignored
+static void testStopsAndBounces()
+{
+  resetIsrState();
+  WN_Core *core = startCore(PULSE_COUNTING_CAPTURE);
+  core->onInstantWindUpdate(onSample);
+  HardwareTimer *timer = pulseCaptureTimer;
+  uint32_t ticks = 0;
+  Taken taken;
+
+  timer->fireCapture(mock_pin_timer_channel, ticks);
+  mock_millis += CAPTURE_MAX_PERIOD_MS - 1;
+  ticks += (CAPTURE_MAX_PERIOD_MS - 1) * (CAPTURE_TIMER_HZ / 1000);
+  timer->fireCapture(mock_pin_timer_channel, ticks & 0xFFFF);
+  take(core, taken);
+  CHECK(taken.pulses == 2 && taken.periods == 1);
+
+  taken = Taken();
+  mock_millis += CAPTURE_MAX_PERIOD_MS;
+  ticks += CAPTURE_MAX_PERIOD_MS * (CAPTURE_TIMER_HZ / 1000);
+  timer->fireCapture(mock_pin_timer_channel, ticks & 0xFFFF);
+  take(core, taken);
+  CHECK(taken.pulses == 1 && taken.periods == 0);
+
+  // bounce right after a pulse
+  taken = Taken();
+  timer->fireCapture(mock_pin_timer_channel, (ticks + CAPTURE_MIN_PERIOD_TICKS - 1) & 0xFFFF);
+  take(core, taken);
+  CHECK(taken.pulses == 0 && taken.periods == 0);
+
+  // calm: whole windows without pulses
+  core->_next_window_millis = mock_millis + SAMPLE_DURATION_MS;
+  sample_callbacks = 0;
+  runLoop(core, 3 * SAMPLE_DURATION_MS);
+  CHECK(sample_callbacks == 3);
+  CHECK(last_sample.speed == 0 && last_sample.gust == 0);
+
+  // a steady rotor: every window gives the speed of its period, mean and gust alike
+  sample_callbacks = 0;
+  const uint16_t period = 2500;
+  for (int window = 0; window < 5; window++)
+  {
+    for (int ms = 0; ms < (int)SAMPLE_DURATION_MS; ms++)
+    {
+      if (ms % (period / (CAPTURE_TIMER_HZ / 1000)) == 0)
+      {
+        ticks += period;
+        timer->fireCapture(mock_pin_timer_channel, ticks & 0xFFFF);
+      }
+      runLoop(core, 1);
+    }
+  }
+  float expected = core->pulsesToSpeedUnitInUse((float)SAMPLE_DURATION * CAPTURE_TIMER_HZ / period);
+  CHECK(sample_callbacks == 5);
+  CHECK(fabsf(last_sample.speed - expected) < 1e-4f);
+  CHECK(fabsf(last_sample.gust - expected) < 1e-4f);
+}
+
+int main()
+{
+  testPendingCaptureAtStart();
+  testConcurrentCaptureAndRead();
+  testConcurrentPulsesAndLoop();
+  testWraparounds();
+  testStopsAndBounces();
+  TEST_END();
+}
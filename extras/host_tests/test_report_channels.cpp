@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Report channels fed sample by sample: each channel is called on every multiple of its interval since start
+// with the report of its period, the same as computeReportForRecentPeriodInSec() at that sample,
+// and settings out of range are rejected without changing the channel.
+
+#include "test.h"
+#include "core_access.h"
+#include <random>
+#include <vector>
+
+#define SAMPLE_SEC 3 // SAMPLE_DURATION of Windnerd_Core.cpp
+
+struct ChannelCall
+{
+  uint32_t sample; // sample count when it was called
+  bool matches;    // same report as computed directly
+};
+
+static WN_Core *current_core;
+static uint16_t periods[REPORT_CHANNEL_COUNT];
+static std::vector<ChannelCall> calls[REPORT_CHANNEL_COUNT];
+static wn_wind_report_t last_reports[REPORT_CHANNEL_COUNT];
+
+static bool sameReport(const wn_wind_report_t &a, const wn_wind_report_t &b)
+{
+  return a.avg_speed == b.avg_speed && a.avg_dir == b.avg_dir && a.min_speed == b.min_speed && a.max_speed == b.max_speed;
+}
+
+template <int channel>
+static void onReport(wn_wind_report_t report)
+{
+  wn_wind_report_t direct = current_core->computeReportForRecentPeriodInSec(periods[channel]);
+  calls[channel].push_back({current_core->getSampleCount(), sameReport(report, direct)});
+  last_reports[channel] = report;
+}
+
+static void (*const callbacks[])(wn_wind_report_t) = {onReport<0>, onReport<1>, onReport<2>, onReport<3>};
+static_assert(sizeof(callbacks) / sizeof(callbacks[0]) == REPORT_CHANNEL_COUNT, "one callback per channel");
+
+static void setChannel(WN_Core &core, uint8_t channel, uint16_t period, uint16_t interval)
+{
+  periods[channel] = period;
+  calls[channel].clear();
+  CHECK(core.setReportChannel(channel, period, interval, callbacks[channel]));
+}
+
+// every call at a multiple of the interval, none missed, each matching the direct computation
+static void checkCalls(uint8_t channel, uint16_t interval, uint32_t first_sample, uint32_t end_sample)
+{
+  uint32_t interval_samples = interval / SAMPLE_SEC;
+  uint32_t expected = (end_sample / interval_samples) - (first_sample - 1) / interval_samples;
+  CHECK(calls[channel].size() == expected);
+  for (const ChannelCall &call : calls[channel])
+  {
+    CHECK(call.sample % interval_samples == 0);
+    CHECK(call.matches);
+  }
+}
+
+static void testChannels()
+{
+  WN_Core &core = *new WN_Core;
+  current_core = &core;
+  setChannel(core, 0, 120, 3);    // live 2 minutes, every sample
+  setChannel(core, 1, 600, 600);  // 10 minutes at each 10 minute mark
+  setChannel(core, 2, 3600, 300); // hour from the history, every 5 minutes
+  setChannel(core, 3, 100, 33);   // period and interval not aligned on minutes
+
+  // 3 hours of random walk
+  std::mt19937 random(24);
+  int pulses = 20, dir = 180;
+  const uint32_t samples = 3 * 60 * SAMPLES_PER_MINUTE;
+  for (uint32_t n = 0; n < samples; n++)
+  {
+    pulses = std::max(0, std::min(200, pulses + (int)(random() % 5) - 2));
+    dir = (dir + 360 + (int)(random() % 7) - 3) % 360;
+    feedSample(core, pulses, dir);
+  }
+  checkCalls(0, 3, 1, samples);
+  checkCalls(1, 600, 1, samples);
+  checkCalls(2, 300, 1, samples);
+  checkCalls(3, 33, 1, samples);
+  printf("  %zu, %zu, %zu and %zu reports over %u samples\n", calls[0].size(), calls[1].size(), calls[2].size(), calls[3].size(), samples);
+
+  // an hour of steady wind: the hour report is that wind, within the 0.024% of the Q15 vector mean speed
+  for (uint32_t n = 0; n < 60 * SAMPLES_PER_MINUTE; n++)
+  {
+    feedSample(core, 25, 200);
+  }
+  CHECK(calls[2].back().sample == samples + 60 * SAMPLES_PER_MINUTE);
+  CHECK(fabsf(last_reports[2].avg_speed / core.pulsesToSpeedUnitInUse(25) - 1) < 0.00025f);
+  CHECK(last_reports[2].min_speed == core.pulsesToSpeedUnitInUse(25));
+  CHECK(last_reports[2].max_speed == core.pulsesToSpeedUnitInUse(25));
+  CHECK(last_reports[2].avg_dir >= 199 && last_reports[2].avg_dir <= 201);
+
+  // a NULL callback disables a channel
+  size_t before = calls[0].size();
+  CHECK(core.setReportChannel(0, 120, 3, NULL));
+  feedSample(core, 25, 200);
+  CHECK(calls[0].size() == before);
+  CHECK(calls[1].back().matches && calls[2].back().matches && calls[3].back().matches);
+  delete &core;
+}
+
+static void testInvalidSettings()
+{
+  WN_Core core;
+  current_core = &core;
+  setChannel(core, 1, 60, 60);
+
+  CHECK(!core.setReportChannel(REPORT_CHANNEL_COUNT, 60, 60, onReport<0>));
+  CHECK(!core.setReportChannel(1, 0, 60, onReport<1>));
+  CHECK(!core.setReportChannel(1, SAMPLE_SEC - 1, 60, onReport<1>));
+  CHECK(!core.setReportChannel(1, 60, 0, onReport<1>));
+  CHECK(!core.setReportChannel(1, 60, SAMPLE_SEC - 1, onReport<1>));
+  CHECK(!core.setReportChannel(1, 60, 10, onReport<1>)); // not a multiple of the sample duration
+  // longer than the rolling buffer: from the history, whole minutes only
+  CHECK(!core.setReportChannel(1, ROLLING_BUFFER_LENGTH * SAMPLE_SEC + 3, 60, onReport<1>));
+  CHECK(!core.setReportChannel(1, 3600, 30, onReport<1>));
+  CHECK(core.setReportChannel(1, ROLLING_BUFFER_LENGTH * SAMPLE_SEC, 30, onReport<1>));
+  CHECK(core.setReportChannel(1, 3600, 120, onReport<1>));
+  CHECK(core.setReportChannel(1, SAMPLE_SEC, SAMPLE_SEC, onReport<1>));
+
+  // a rejected setting leaves the channel as it was: every sample, 3 seconds
+  CHECK(!core.setReportChannel(1, 3600, 30, onReport<1>));
+  periods[1] = SAMPLE_SEC;
+  for (int n = 0; n < 5; n++)
+  {
+    feedSample(core, 10, 90);
+  }
+  CHECK(calls[1].size() == 5);
+  checkCalls(1, SAMPLE_SEC, 1, 5);
+}
+
+int main()
+{
+  testChannels();
+  testInvalidSettings();
+  TEST_END();
+}
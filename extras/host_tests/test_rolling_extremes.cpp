@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Sliding maximum, minimum and mean of the rolling buffer against a rescan of the window after every sample,
+// with traces that overflow the candidate deques (long ramps), then the cost per sample of the worst trace.
+
+#include "test.h"
+#define private public
+#include "Windnerd_Rolling_Buffer.h"
+#undef private
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+// pulses of sample n for each kind of trace
+static int trace(int kind, int n, int previous, std::mt19937 &random)
+{
+  switch (kind)
+  {
+  case 0: // random walk
+    return std::max(0, std::min(4000, previous + (int)(random() % 7) - 3));
+  case 1: // ramps up and down of 300 samples, ten times the deque length
+    return (n / 300) % 2 ? 300 - n % 300 : n % 300;
+  case 2: // noise
+    return random() % 1000;
+  case 3: // long decreasing ramp, then increasing
+    return n < 10000 ? 20000 - n : n;
+  case 4: // staircase: steps of equal samples, going down then up
+    return (n / 1000) % 2 ? 500 - (n % 1000) / 4 : 250 + (n % 1000) / 4;
+  default: // ramp with noise, out of the deque now and then
+    return std::max(0, (n % 2000) / 2 + (int)(random() % 40) - 20);
+  }
+}
+
+static void testAgainstRescan()
+{
+  const size_t windows[] = {1, 2, 20, 33, 100, 200, 799, 800, 900};
+  long checks = 0, errors = 0;
+  for (size_t window : windows)
+  {
+    for (int kind = 0; kind < 6; kind++)
+    {
+      std::mt19937 random(kind * 1000 + window);
+      WN_ROLLINGBUFFER buffer;
+      buffer.setExtremesWindow(window);
+      size_t current = window;
+      int pulses = 20;
+      for (int n = 0; n < 20000; n++)
+      {
+        // a shorter window set half way, rebuilt from the samples already stored
+        if (n == 7000)
+        {
+          current = window / 2 + 1;
+          buffer.setExtremesWindow(current);
+        }
+        pulses = trace(kind, n, pulses, random);
+        wn_raw_wind_sample_t sample = {(uint16_t)pulses, (uint16_t)(random() % 360), true};
+        buffer.addRawSample(sample);
+
+        size_t length = std::min(std::min(current, (size_t)ROLLING_BUFFER_LENGTH), buffer.count);
+        uint16_t highest = 0, lowest = UINT16_MAX;
+        uint32_t sum = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+          uint16_t p = buffer.get(i).pulses;
+          highest = std::max(highest, p);
+          lowest = std::min(lowest, p);
+          sum += p;
+        }
+        checks++;
+        bool same = buffer.getWindowMaxPulses() == highest && buffer.getWindowMinPulses() == lowest &&
+                    fabsf(buffer.getWindowMeanPulses() - (float)sum / length) < 1e-3f;
+        if (!same && errors++ < 5)
+        {
+          printf("  window %zu trace %d sample %d: max %u min %u, rescan %u %u\n", window, kind, n,
+                 buffer.getWindowMaxPulses(), buffer.getWindowMinPulses(), highest, lowest);
+        }
+      }
+    }
+  }
+  CHECK(errors == 0);
+  printf("  %ld samples compared with a rescan of the window\n", checks);
+}
+
+// the decreasing ramp keeps the maximum deque overflowing: the window is rescanned once per deque length
+static void benchmark()
+{
+  const int samples = 200000;
+  for (int kind : {0, 3})
+  {
+    WN_ROLLINGBUFFER buffer;
+    buffer.setExtremesWindow(ROLLING_BUFFER_LENGTH);
+    std::mt19937 random(1);
+    volatile uint32_t sink = 0;
+    int pulses = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < samples; n++)
+    {
+      pulses = kind == 3 ? 30000 - n % 30000 : trace(kind, n, pulses, random);
+      wn_raw_wind_sample_t sample = {(uint16_t)pulses, 0, true};
+      buffer.addRawSample(sample);
+      sink += buffer.getWindowMaxPulses();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / samples;
+    printf("  %s, 800 samples window: %.0f ns per sample on this host\n", kind == 3 ? "decreasing ramp" : "random walk", ns);
+  }
+}
+
+int main()
+{
+  testAgainstRescan();
+  benchmark();
+  TEST_END();
+}
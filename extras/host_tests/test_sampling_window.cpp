@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Sampling windows closed late or after loop() was blocked: pulses normalized by the measured duration,
+// windows caught up with the time left over carried to the next close, catch up capped to a minute of samples.
+
+#include "test.h"
+#define private public
+#include "Windnerd_Core.cpp"
+#undef private
+
+static WN_Core *startCore()
+{
+  isr_pulse_total = 0;
+  last_isr_pulse_total = 0;
+  window_pulse_count = 0;
+  mock_millis = 1000;
+  mock_micros = 1000000;
+  WN_Core *core = new WN_Core(CORE_SPEED_LED_PIN, CORE_NORTH_LED_PIN, CORE_SPEED_INPUT_PIN, CORE_SCL_PIN, CORE_SDA_PIN, PULSE_COUNTING_INTERRUPT);
+  core->begin();
+  return core;
+}
+
+// the window closes ms after the previous one, us measured by micros(), with pulses counted meanwhile
+static void closeAfter(WN_Core *core, uint32_t ms, uint32_t us, uint32_t pulses)
+{
+  mock_millis += ms;
+  mock_micros += us;
+  isr_pulse_total += pulses;
+  core->closeSamplingWindow(mock_millis);
+}
+
+// pulses of the newest samples, index 0 is the last one
+static uint16_t pulsesFromLast(WN_Core *core, size_t index)
+{
+  return core->RollingBuffer.get(index).pulses;
+}
+
+static void testOnTime()
+{
+  WN_Core *core = startCore();
+  closeAfter(core, 3000, 3000000, 30);
+  CHECK(core->getSampleCount() == 1);
+  CHECK(pulsesFromLast(core, 0) == 30);
+  CHECK(core->_window_carry_ms == 0);
+  CHECK(core->getLostSampleCount() == 0);
+  delete core;
+}
+
+// a window closed 600 ms late holds 3.6 s of pulses, it is scaled to 3 s and the 600 ms are carried
+static void testLateWindow()
+{
+  WN_Core *core = startCore();
+  closeAfter(core, 3600, 3600000, 36);
+  CHECK(core->getSampleCount() == 1);
+  CHECK(pulsesFromLast(core, 0) == 30);
+  CHECK(core->_window_carry_ms == 600);
+
+  // micros() is the measured duration: 3.3 s elapsed for a window millis() saw on time
+  closeAfter(core, 3000, 3300000, 33);
+  CHECK(core->getSampleCount() == 2);
+  CHECK(pulsesFromLast(core, 0) == 30);
+
+  // the rounding error is carried: 10 pulses over 3 windows of 3.6 s give 8.33 pulses, 8 or 9 but 25 in total
+  uint32_t sum = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    closeAfter(core, 3000, 3600000, 10);
+    sum += pulsesFromLast(core, 0);
+  }
+  CHECK(sum == 25);
+  CHECK(core->getLostSampleCount() == 0);
+  delete core;
+}
+
+// windows closed 1 s late every time: the carry adds a window now and then, so samples keep up with time
+static void testCarryKeepsUpWithTime()
+{
+  WN_Core *core = startCore();
+  const int closes = 300;
+  for (int i = 0; i < closes; i++)
+  {
+    closeAfter(core, 4000, 4000000, 40);
+    CHECK(core->_window_carry_ms > -(int32_t)SAMPLE_DURATION_MS / 2 && core->_window_carry_ms <= (int32_t)SAMPLE_DURATION_MS / 2);
+  }
+  uint32_t expected = closes * 4000 / SAMPLE_DURATION_MS;
+  CHECK(core->getSampleCount() + 1 >= expected && core->getSampleCount() <= expected + 1);
+  // 10 pulses a second: 30 in every sample
+  for (size_t i = 0; i < 100; i++)
+  {
+    CHECK(pulsesFromLast(core, i) == 30);
+  }
+  CHECK(core->getLostSampleCount() == 0);
+  delete core;
+}
+
+// loop() blocked for 30 s: 10 samples with the mean speed of the span, the extra pulses spread over the first ones
+static void testLongWindowCaughtUp()
+{
+  WN_Core *core = startCore();
+  closeAfter(core, 30000, 30000000, 305);
+  CHECK(core->getSampleCount() == 10);
+  uint32_t sum = 0;
+  for (size_t i = 0; i < 10; i++)
+  {
+    uint16_t pulses = pulsesFromLast(core, i);
+    CHECK(pulses == 30 || pulses == 31);
+    sum += pulses;
+  }
+  CHECK(sum == 305);
+  CHECK(core->_window_carry_ms == 0);
+  CHECK(core->getLostSampleCount() == 0);
+
+  // a span of 20 windows plus 1.4 s: 20 samples, the 1.4 s are carried
+  closeAfter(core, 61400, 61400000, 614);
+  CHECK(core->getSampleCount() == 30);
+  CHECK(core->_window_carry_ms == 1400);
+  CHECK(core->getLostSampleCount() == 0);
+  for (size_t i = 0; i < 20; i++)
+  {
+    CHECK(pulsesFromLast(core, i) == 30);
+  }
+  delete core;
+}
+
+// loop() blocked for 5 minutes: only the last minute of samples is stored, the 80 others are counted as lost,
+// with the speed of the whole span measured by millis() as micros() could have wrapped
+static void testCatchUpCap()
+{
+  WN_Core *core = startCore();
+  closeAfter(core, 300000, 300000000, 3000);
+  CHECK(MAX_CATCH_UP_SAMPLES == 20);
+  CHECK(core->getSampleCount() == MAX_CATCH_UP_SAMPLES);
+  CHECK(core->getLostSampleCount() == 100 - MAX_CATCH_UP_SAMPLES);
+  for (size_t i = 0; i < MAX_CATCH_UP_SAMPLES; i++)
+  {
+    CHECK(pulsesFromLast(core, i) == 30);
+  }
+
+  // 21 windows, one over the cap
+  closeAfter(core, 63000, 63000000, 630);
+  CHECK(core->getSampleCount() == 2 * MAX_CATCH_UP_SAMPLES);
+  CHECK(core->getLostSampleCount() == 100 - MAX_CATCH_UP_SAMPLES + 1);
+  CHECK(pulsesFromLast(core, 0) == 30);
+
+  // blocked longer than the micros() wraparound (71 minutes): micros() is ignored
+  closeAfter(core, 80 * 60000, 12345, 80 * 60 * 10);
+  CHECK(core->getSampleCount() == 3 * MAX_CATCH_UP_SAMPLES);
+  CHECK(core->getLostSampleCount() == 100 - MAX_CATCH_UP_SAMPLES + 1 + 1600 - MAX_CATCH_UP_SAMPLES);
+  CHECK(pulsesFromLast(core, 0) == 30);
+
+  // back on time
+  closeAfter(core, 3000, 3000000, 30);
+  CHECK(core->getSampleCount() == 3 * MAX_CATCH_UP_SAMPLES + 1);
+  CHECK(pulsesFromLast(core, 0) == 30);
+  delete core;
+}
+
+int main()
+{
+  testOnTime();
+  testLateWindow();
+  testCarryKeepsUpWithTime();
+  testLongWindowCaughtUp();
+  testCatchUpCap();
+  TEST_END();
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// SHA-256 against the FIPS 180 examples, HMAC-SHA256 against RFC 4231, fed in pieces of every size.
+// Prints the host throughput and the cost of signing a payload through the writer.
+
+#include "test.h"
+#include "Windnerd_Sha256.h"
+#include "Windnerd_Wtp_Writer.h"
+#include <chrono>
+#include <string>
+
+static std::string hex(const uint8_t *data, size_t length)
+{
+  std::string s;
+  char digits[3];
+  for (size_t i = 0; i < length; i++)
+  {
+    snprintf(digits, sizeof(digits), "%02x", data[i]);
+    s += digits;
+  }
+  return s;
+}
+
+// the message is fed piece by piece, to cross block boundaries at every offset
+static std::string sha256(const std::string &message, size_t piece = SIZE_MAX)
+{
+  WN_SHA256 sha;
+  sha.begin();
+  for (size_t i = 0; i < message.size(); i += piece)
+  {
+    sha.update((const uint8_t *)message.data() + i, std::min(piece, message.size() - i));
+  }
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  sha.finish(digest);
+  return hex(digest, sizeof(digest));
+}
+
+static std::string hmac(const std::string &key, const std::string &message, size_t piece = SIZE_MAX)
+{
+  WN_HMAC_SHA256 hmac;
+  hmac.begin((const uint8_t *)key.data(), key.size());
+  for (size_t i = 0; i < message.size(); i += piece)
+  {
+    hmac.update((const uint8_t *)message.data() + i, std::min(piece, message.size() - i));
+  }
+  uint8_t mac[SHA256_DIGEST_SIZE];
+  hmac.finish(mac);
+  return hex(mac, sizeof(mac));
+}
+
+static void testSha256()
+{
+  const std::string two_blocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  CHECK(sha256("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  CHECK(sha256("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  for (size_t piece = 1; piece <= two_blocks.size(); piece++)
+  {
+    CHECK(sha256(two_blocks, piece) == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  }
+  CHECK(sha256("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu") ==
+        "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1");
+  CHECK(sha256(std::string(1000000, 'a'), 4093) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+  // lengths around the padding boundary: 55 bytes fit one block, 56 need two
+  CHECK(sha256(std::string(55, 'a')) == "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318");
+  CHECK(sha256(std::string(56, 'a')) == "b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a");
+  CHECK(sha256(std::string(64, 'a')) == "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb");
+}
+
+static void testHmac()
+{
+  // RFC 4231 test cases 1 to 4, 6 and 7 (5 is a truncated output)
+  CHECK(hmac(std::string(20, '\x0b'), "Hi There") == "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+  CHECK(hmac("Jefe", "what do ya want for nothing?") == "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+  CHECK(hmac(std::string(20, '\xaa'), std::string(50, '\xdd'), 3) == "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe");
+  std::string key4;
+  for (int i = 1; i <= 25; i++) key4 += (char)i;
+  CHECK(hmac(key4, std::string(50, '\xcd')) == "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b");
+  CHECK(hmac(std::string(131, '\xaa'), "Test Using Larger Than Block-Size Key - Hash Key First") ==
+        "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+  CHECK(hmac(std::string(131, '\xaa'),
+             "This is a test using a larger than block-size key and a larger than block-size data. "
+             "The key needs to be hashed before being used by the HMAC algorithm.",
+             1) == "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2");
+}
+
+// the writer feeds the signer from its buffer, the MAC must be the one of every byte written
+static void testWriterSigning()
+{
+  struct NullPrint : Print
+  {
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+  } null;
+  const char key[] = "3122fd880084fd55";
+  std::string written;
+  WN_HMAC_SHA256 signer;
+  signer.begin((const uint8_t *)key, 16);
+  WN_WTP_WRITER writer(&null);
+  writer.setSigner(&signer);
+  for (int i = 0; i < 300; i++)
+  {
+    char line[32];
+    snprintf(line, sizeof(line), "s,wi=%d.%d,wd=%d;", i % 40, i % 10, i % 360);
+    writer.print(line);
+    written += line;
+  }
+  uint8_t mac[SHA256_DIGEST_SIZE];
+  writer.finishSignature(mac);
+  CHECK(hex(mac, sizeof(mac)) == hmac(std::string(key, 16), written));
+}
+
+static void benchmark()
+{
+  struct NullPrint : Print
+  {
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+  } null;
+  std::string big(4 << 20, 'x');
+  auto start = std::chrono::steady_clock::now();
+  sha256(big, 32);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("  SHA-256: %.1f MB/s on this host\n", 4 / seconds);
+
+  const int repeats = 5000;
+  const char line[] = "s,wi=12.3,wd=245;";
+  for (int signing = 0; signing < 2; signing++)
+  {
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+      WN_HMAC_SHA256 signer;
+      WN_WTP_WRITER writer(&null);
+      if (signing)
+      {
+        signer.begin((const uint8_t *)"3122fd880084fd55", 16);
+        writer.setSigner(&signer);
+      }
+      for (int i = 0; i < 4000 / 17; i++) writer.print(line);
+      uint8_t mac[SHA256_DIGEST_SIZE];
+      writer.finishSignature(mac);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+    printf("  4 KB payload through the writer, %s: %.1f us on this host\n", signing ? "signed" : "not signed", us);
+  }
+}
+
+int main()
+{
+  testSha256();
+  testHmac();
+  testWriterSigning();
+  benchmark();
+  TEST_END();
+}
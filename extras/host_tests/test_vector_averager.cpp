@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Q15 vector averaging (sin/cos table, CORDIC) against a double precision reference, next to the float
+// averaging it replaced, on random, steady, veering, near calm and saturated traces.
+
+#include "test.h"
+#include "Windnerd_Vector_Averager.h"
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+typedef struct
+{
+  uint16_t pulses;
+  uint16_t dir;
+} sample_t;
+
+typedef struct
+{
+  double pulses_avg;
+  double dir; // 0..360, not rounded
+} reference_t;
+
+static reference_t reference(const std::vector<sample_t> &samples)
+{
+  double x = 0, y = 0;
+  for (const sample_t &sample : samples)
+  {
+    x += sample.pulses * cos(sample.dir * M_PI / 180);
+    y += sample.pulses * sin(sample.dir * M_PI / 180);
+  }
+  double dir = atan2(y, x) * 180 / M_PI;
+  return {hypot(x, y) / samples.size(), dir < 0 ? dir + 360 : dir};
+}
+
+// the float averaging used before the Q15 version
+static wn_raw_wind_report_t floatReport(const std::vector<sample_t> &samples)
+{
+  float x = 0, y = 0;
+  for (const sample_t &sample : samples)
+  {
+    float rad = sample.dir * (M_PI / 180.0f);
+    x += sample.pulses * cosf(rad);
+    y += sample.pulses * sinf(rad);
+  }
+  float avg_x = x / samples.size();
+  float avg_y = y / samples.size();
+  float dir = atan2f(avg_y, avg_x) * 180.0f / M_PI;
+  if (dir < 0)
+    dir += 360.0f;
+  wn_raw_wind_report_t report;
+  report.pulses_avg = sqrtf(avg_x * avg_x + avg_y * avg_y);
+  report.dir_avg = (uint16_t)(dir + 0.5f) % 360;
+  return report;
+}
+
+static wn_raw_wind_report_t q15Report(const std::vector<sample_t> &samples)
+{
+  WN_VECTOR_AVERAGER averager;
+  for (const sample_t &sample : samples)
+    averager.accumulate(sample.pulses, sample.dir);
+  wn_raw_wind_report_t report;
+  averager.computeReportFromAccumulatedValues(&report);
+  return report;
+}
+
+static double angleError(double dir, double reference_dir)
+{
+  double error = fabs(dir - reference_dir);
+  return error > 180 ? 360 - error : error;
+}
+
+typedef struct
+{
+  double q15_angle = 0, float_angle = 0, q15_speed = 0, float_speed = 0;
+} worst_t;
+
+static void compare(const std::vector<sample_t> &samples, worst_t &worst)
+{
+  reference_t exact = reference(samples);
+  wn_raw_wind_report_t q15 = q15Report(samples);
+  wn_raw_wind_report_t single = floatReport(samples);
+  // both round to the nearest degree, 0.5 of the error comes from it
+  worst.q15_angle = std::max(worst.q15_angle, angleError(q15.dir_avg, exact.dir));
+  worst.float_angle = std::max(worst.float_angle, angleError(single.dir_avg, exact.dir));
+  worst.q15_speed = std::max(worst.q15_speed, fabs(q15.pulses_avg - exact.pulses_avg) / exact.pulses_avg);
+  worst.float_speed = std::max(worst.float_speed, fabs(single.pulses_avg - exact.pulses_avg) / exact.pulses_avg);
+}
+
+static void testTraces()
+{
+  std::mt19937 random(3);
+  std::normal_distribution<double> normal(0, 1);
+  const char *names[] = {"uniform random", "steady 12 m/s +-20 deg", "veering through north", "saturated 32767 pulses"};
+  for (int kind = 0; kind < 4; kind++)
+  {
+    for (int length : {20, 200, 1200})
+    {
+      worst_t worst;
+      for (int trial = 0; trial < 2000; trial++)
+      {
+        std::vector<sample_t> samples;
+        double mean_dir = random() % 360;
+        for (int i = 0; i < length; i++)
+        {
+          double pulses, dir;
+          if (kind == 0)
+            pulses = random() % 200, dir = random() % 360;
+          else if (kind == 1)
+            pulses = 27 + normal(random) * 5, dir = mean_dir + normal(random) * 20;
+          else if (kind == 2)
+            pulses = 10 + random() % 20, dir = 300 + 120.0 * i / length + normal(random) * 10;
+          else
+            pulses = 32767, dir = mean_dir + normal(random) * 30;
+          samples.push_back({(uint16_t)std::max(0.0, std::min(32767.0, round(pulses))), (uint16_t)(((long)round(dir) % 360 + 360) % 360)});
+        }
+        // a resultant much shorter than the samples points nowhere in particular, see testNearCalm
+        if (reference(samples).pulses_avg < 2)
+          continue;
+        compare(samples, worst);
+      }
+      // within the rounding to a degree and the Q15 table resolution
+      CHECK(worst.q15_angle <= 0.5 + 0.01);
+      CHECK(worst.q15_speed <= 0.002);
+      printf("  %-24s %4d samples: angle %.3f deg (float %.3f), speed %.4f%% (float %.4f%%)\n", names[kind], length,
+             worst.q15_angle, worst.float_angle, worst.q15_speed * 100, worst.float_speed * 100);
+    }
+  }
+}
+
+// samples in every direction nearly cancel: the direction of the short resultant is sensitive to the table rounding
+static void testNearCalm()
+{
+  std::mt19937 random(5);
+  worst_t worst;
+  int trials = 0;
+  while (trials < 2000)
+  {
+    std::vector<sample_t> samples;
+    for (int i = 0; i < 200; i++)
+      samples.push_back({(uint16_t)(50 + random() % 10), (uint16_t)(random() % 360)});
+    reference_t exact = reference(samples);
+    if (exact.pulses_avg < 0.5 || exact.pulses_avg >= 2)
+      continue;
+    compare(samples, worst);
+    trials++;
+  }
+  CHECK(worst.q15_angle <= 0.5 + 0.01);
+  printf("  near calm, resultant 0.5-2 pulses out of 55: angle %.3f deg (float %.3f)\n", worst.q15_angle, worst.float_angle);
+}
+
+// table symmetries: every degree against sin and cos
+static void testTable()
+{
+  double worst = 0;
+  for (uint16_t deg = 0; deg < 720; deg++)
+  {
+    worst = std::max(worst, fabs(wn_sin_q15(deg) - 32768 * sin(deg * M_PI / 180)));
+    worst = std::max(worst, fabs(wn_cos_q15(deg) - 32768 * cos(deg * M_PI / 180)));
+  }
+  // 32768 is stored as 32767
+  CHECK(worst <= 1.0);
+  printf("  sin/cos table: worst error %.2f / 32768\n", worst);
+}
+
+// a minute merged from its aggregate gives the report of its samples accumulated one by one
+static void testAggregate()
+{
+  std::mt19937 random(9);
+  int mismatches = 0;
+  for (int trial = 0; trial < 1000; trial++)
+  {
+    WN_VECTOR_AVERAGER samples, merged;
+    wn_raw_wind_aggregate_t aggregate;
+    for (int i = 0; i < 20; i++)
+    {
+      wn_raw_wind_sample_t sample = {(uint16_t)(random() % 300), (uint16_t)(random() % 360), true};
+      samples.accumulate(sample);
+      wn_aggregate_sample(aggregate, sample);
+    }
+    merged.accumulate(aggregate);
+    wn_raw_wind_report_t a, b;
+    samples.computeReportFromAccumulatedValues(&a);
+    merged.computeReportFromAccumulatedValues(&b);
+    if (a.dir_avg != b.dir_avg || a.pulses_avg != b.pulses_avg || a.pulses_max != b.pulses_max || a.pulses_min != b.pulses_min)
+      mismatches++;
+  }
+  CHECK(mismatches == 0);
+}
+
+static void benchmark()
+{
+  std::mt19937 random(1);
+  std::vector<sample_t> samples;
+  for (int i = 0; i < 1200; i++)
+    samples.push_back({(uint16_t)(random() % 200), (uint16_t)(random() % 360)});
+  const int rounds = 2000;
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++)
+    sink += q15Report(samples).pulses_avg;
+  double q15_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++)
+    sink += floatReport(samples).pulses_avg;
+  double float_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  // the host has an FPU, the Cortex-M0+ does not: only the Q15 figure says anything about the target
+  printf("  1200 samples: %.1f ns per sample Q15, %.1f ns float on this host\n", q15_ns / rounds / 1200, float_ns / rounds / 1200);
+}
+
+int main()
+{
+  testTable();
+  testTraces();
+  testNearCalm();
+  testAggregate();
+  benchmark();
+  TEST_END();
+}
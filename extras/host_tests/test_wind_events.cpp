@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Wind event triggers fed sample by sample: the speed trigger on a step of the 1 minute mean, its hysteresis
+// and the min spacing between events, the direction shift across north and below the min speed.
+
+#include "test.h"
+#include "core_access.h"
+#include <vector>
+
+struct FiredEvent
+{
+  uint32_t sample; // sample count when it fired
+  wn_wind_event_type_t type;
+  float value;
+};
+
+static std::vector<FiredEvent> fired;
+static WN_Core *current_core;
+
+static void onEvent(wn_wind_event_t event)
+{
+  fired.push_back({current_core->getSampleCount(), event.type, event.value});
+}
+
+static WN_Core *newCore()
+{
+  WN_Core *core = new WN_Core;
+  current_core = core;
+  fired.clear();
+  core->onWindEvent(onEvent);
+  return core;
+}
+
+static void feed(WN_Core &core, int samples, uint16_t pulses, uint16_t dir = 0)
+{
+  for (int i = 0; i < samples; i++)
+  {
+    feedSample(core, pulses, dir);
+  }
+}
+
+// the 1 minute mean goes from 10 to 30 pulses one pulse per sample after the step, so it reaches
+// the threshold of 20 on the 10th sample: the event fires then, once, until the mean falls below 15
+static void testSpeedHysteresis()
+{
+  WN_Core &core = *newCore();
+  core.setEventMinSpacingSec(0);
+  float threshold = core.pulsesToSpeedUnitInUse(20);
+  core.setSpeedTrigger(threshold, threshold - core.pulsesToSpeedUnitInUse(15));
+
+  feed(core, 20, 10);
+  CHECK(fired.empty());
+  feed(core, 9, 30);
+  CHECK(fired.empty());
+  feed(core, 1, 30);
+  CHECK(fired.size() == 1);
+  if (fired.size() != 1) return;
+  CHECK(fired[0].sample == 30);
+  CHECK(fired[0].type == WIND_EVENT_SPEED);
+  CHECK(fired[0].value == threshold);
+
+  // above the threshold, then down to a mean of 17 which does not re-arm it, and back up
+  feed(core, 40, 30);
+  feed(core, 20, 17);
+  feed(core, 40, 30);
+  CHECK(fired.size() == 1);
+
+  // a mean below 15 re-arms it, the next rise fires again on the 10th sample above 20
+  feed(core, 20, 10);
+  uint32_t rise = core.getSampleCount();
+  feed(core, 20, 30);
+  CHECK(fired.size() == 2);
+  CHECK(fired.size() == 2 && fired[1].sample == rise + 10);
+  delete &core;
+}
+
+// with the default min spacing of 100 samples, a re-armed trigger waits for the spacing, then fires at once
+static void testMinSpacing()
+{
+  WN_Core &core = *newCore();
+  float threshold = core.pulsesToSpeedUnitInUse(20);
+  core.setSpeedTrigger(threshold, 0);
+
+  feed(core, 20, 10);
+  feed(core, 20, 30);
+  CHECK(fired.size() == 1);
+  uint32_t first = fired.empty() ? 0 : fired[0].sample;
+
+  // re-armed by a calm minute, above the threshold again well before the spacing has elapsed
+  feed(core, 20, 0);
+  feed(core, 20, 30);
+  CHECK(fired.size() == 1);
+  while (core.getSampleCount() < first + DEFAULT_EVENT_MIN_SPACING_SAMPLES)
+  {
+    feedSample(core, 30, 0);
+  }
+  CHECK(fired.size() == 2);
+  CHECK(fired.size() == 2 && fired[1].sample == first + DEFAULT_EVENT_MIN_SPACING_SAMPLES);
+
+  // a shorter spacing set in seconds, elapsed when the mean rising from 0 reaches 20 pulses on the 14th sample
+  core.setEventMinSpacingSec(60);
+  feed(core, 20, 0);
+  uint32_t rise = core.getSampleCount();
+  feed(core, 20, 30);
+  CHECK(fired.size() == 3);
+  CHECK(fired.size() == 3 && fired[2].sample == rise + 14);
+  delete &core;
+}
+
+// minute directions crossing north: 350 to 10 degrees is a 20 degrees shift, not 340
+static void testDirectionAcrossNorth()
+{
+  WN_Core &core = *newCore();
+  core.setEventMinSpacingSec(0);
+  CHECK(core.setDirectionShiftTrigger(45, 10, 15, core.pulsesToSpeedUnitInUse(5)));
+
+  feed(core, 5 * SAMPLES_PER_MINUTE, 20, 350);
+  feed(core, 3 * SAMPLES_PER_MINUTE, 20, 10);
+  CHECK(fired.empty());
+
+  // 60 degrees from the minutes at 350, checked when the minute closes only
+  feed(core, SAMPLES_PER_MINUTE - 1, 20, 50);
+  CHECK(fired.empty());
+  feedSample(core, 20, 50);
+  CHECK(fired.size() == 1);
+  if (fired.size() != 1) return;
+  CHECK(fired[0].sample == 9 * SAMPLES_PER_MINUTE);
+  CHECK(fired[0].type == WIND_EVENT_DIRECTION_SHIFT);
+  CHECK(fired[0].value >= 59 && fired[0].value <= 61);
+
+  // steady at 50: the minutes at 350 stay within 10 minutes and keep the shift above 45 - 15, no new event
+  feed(core, 10 * SAMPLES_PER_MINUTE, 20, 50);
+  CHECK(fired.size() == 1);
+
+  // all recent minutes at 50 re-armed it, 290 degrees is 120 degrees away across north
+  feed(core, SAMPLES_PER_MINUTE, 20, 290);
+  CHECK(fired.size() == 2);
+  CHECK(fired.size() == 2 && fired[1].value >= 119 && fired[1].value <= 121);
+
+  // the other way across north, from 290 to 330 then 20: 90 degrees from 290
+  feed(core, 10 * SAMPLES_PER_MINUTE, 20, 290);
+  feed(core, SAMPLES_PER_MINUTE, 20, 330);
+  CHECK(fired.size() == 2);
+  feed(core, 10 * SAMPLES_PER_MINUTE, 20, 330);
+  feed(core, SAMPLES_PER_MINUTE, 20, 20);
+  CHECK(fired.size() == 3);
+  CHECK(fired.size() == 3 && fired[2].value >= 49 && fired[2].value <= 51);
+  delete &core;
+}
+
+// minutes slower than the min speed neither fire nor count as a reference direction
+static void testDirectionMinSpeed()
+{
+  WN_Core &core = *newCore();
+  core.setEventMinSpacingSec(0);
+  CHECK(core.setDirectionShiftTrigger(45, 10, 15, core.pulsesToSpeedUnitInUse(5)));
+
+  // a slow last minute is ignored
+  feed(core, 3 * SAMPLES_PER_MINUTE, 20, 0);
+  feed(core, SAMPLES_PER_MINUTE, 2, 90);
+  CHECK(fired.empty());
+  // back above the min speed, 90 degrees from the fast minutes at 0, the slow one is skipped
+  feed(core, SAMPLES_PER_MINUTE, 20, 90);
+  CHECK(fired.size() == 1);
+  CHECK(fired.size() == 1 && fired[0].value >= 89 && fired[0].value <= 91);
+
+  // slow previous minutes give no reference
+  WN_Core &calm = *newCore();
+  calm.setEventMinSpacingSec(0);
+  calm.setDirectionShiftTrigger(45, 10, 15, calm.pulsesToSpeedUnitInUse(5));
+  feed(calm, 5 * SAMPLES_PER_MINUTE, 2, 0);
+  feed(calm, SAMPLES_PER_MINUTE, 20, 90);
+  CHECK(fired.empty());
+  delete &calm;
+  delete &core;
+
+  // invalid settings are rejected
+  WN_Core settings;
+  CHECK(!settings.setDirectionShiftTrigger(45, 0, 15, 0));
+  CHECK(!settings.setDirectionShiftTrigger(45, MINUTE_REPORT_CACHE_LENGTH, 15, 0));
+  CHECK(!settings.setDirectionShiftTrigger(181, 10, 15, 0));
+  CHECK(settings.setDirectionShiftTrigger(180, MINUTE_REPORT_CACHE_LENGTH - 1, 15, 0));
+}
+
+int main()
+{
+  testSpeedHysteresis();
+  testMinSpacing();
+  testDirectionAcrossNorth();
+  testDirectionMinSpeed();
+  TEST_END();
+}
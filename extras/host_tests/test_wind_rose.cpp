@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Wind rose against a recount: sector of every direction for every sector count, directions at sector edges,
+// speed class limits, random samples counted in every bin, bin saturation and settings out of range.
+
+#include "test.h"
+#include "Windnerd_Wind_Rose.h"
+#include <random>
+#include <vector>
+
+#if !WIND_ROSE
+#error "test_wind_rose needs -DWIND_ROSE=1, see run.sh"
+#endif
+
+static const float limits[] = {1, 4, 7, 10, 13}; // default speed classes
+
+// sector centered on k * 360 / sectors holding dir, the edge at half a sector belongs to the next sector clockwise.
+// Angles are scaled by the number of sectors so that sector edges are integers.
+static int referenceSector(int dir, int sectors)
+{
+  int found = -1;
+  for (int k = 0; k < sectors; k++)
+  {
+    int from_edge = ((dir % 360) * sectors - k * 360 + 180 + 360 * sectors) % (360 * sectors);
+    if (from_edge < 360)
+    {
+      CHECK(found < 0); // sectors don't overlap
+      found = k;
+    }
+  }
+  return found;
+}
+
+static int referenceClass(float speed)
+{
+  int speed_class = 0;
+  for (float limit : limits)
+  {
+    if (speed >= limit)
+    {
+      speed_class++;
+    }
+  }
+  return speed_class;
+}
+
+// sector a single sample lands in
+static int sectorOf(WN_WIND_ROSE &rose, uint16_t dir)
+{
+  rose.reset();
+  rose.add(0, dir, 0);
+  for (uint8_t sector = 0; sector < rose.getSectorCount(); sector++)
+  {
+    if (rose.getCount(sector, 0) == 1)
+    {
+      return sector;
+    }
+  }
+  return -1;
+}
+
+// every direction, above 360 too, for every sector count that fits with the default speed classes
+static void testSectors()
+{
+  WN_WIND_ROSE rose;
+  int mismatches = 0;
+  for (int sectors = 1; sectors <= WIND_ROSE_MAX_SECTORS; sectors++)
+  {
+    bool fits = sectors * rose.getClassCount() <= WIND_ROSE_MAX_BINS;
+    CHECK(rose.setSectors(sectors) == fits);
+    if (!fits)
+    {
+      continue;
+    }
+    for (int dir = 0; dir < 720; dir++)
+    {
+      if (sectorOf(rose, dir) != referenceSector(dir, sectors))
+      {
+        mismatches++;
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+
+  // 30 sectors of 12 degrees, with 3 speed classes to fit: north is 354 to 5, 6 and 353 are the edges of the next sectors
+  const float three[] = {4, 10};
+  CHECK(rose.setSpeedClasses(three, 2));
+  CHECK(rose.setSectors(30));
+  for (int dir = 354; dir < 366; dir++)
+  {
+    CHECK(sectorOf(rose, dir % 360) == 0);
+  }
+  CHECK(sectorOf(rose, 353) == 29);
+  CHECK(sectorOf(rose, 6) == 1);
+  CHECK(sectorOf(rose, 180) == 15);
+
+  // 16 sectors of 22.5 degrees: edges between integer directions
+  CHECK(rose.setSectors(16));
+  CHECK(sectorOf(rose, 348) == 15);
+  CHECK(sectorOf(rose, 349) == 0);
+  CHECK(sectorOf(rose, 11) == 0);
+  CHECK(sectorOf(rose, 12) == 1);
+  CHECK(sectorOf(rose, 90) == 4);
+  CHECK(sectorOf(rose, 359) == 0);
+}
+
+static void testSpeedClasses()
+{
+  WN_WIND_ROSE rose;
+  CHECK(rose.getClassCount() == 6);
+  const float speeds[] = {0, 0.99f, 1, 3.99f, 4, 12.99f, 13, 100};
+  const int classes[] = {0, 0, 1, 1, 2, 4, 5, 5};
+  for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++)
+  {
+    rose.reset();
+    rose.add(speeds[i], 0, 0);
+    CHECK(rose.getCount(0, classes[i]) == 1);
+  }
+}
+
+// random samples counted in every bin, over several sector counts and custom speed classes
+static void testRecount()
+{
+  std::mt19937 random(22);
+  const int sector_counts[] = {4, 8, 16, 18, 30, 36};
+  for (int sectors : sector_counts)
+  {
+    WN_WIND_ROSE rose;
+    if (sectors * rose.getClassCount() > WIND_ROSE_MAX_BINS)
+    {
+      const float three[] = {4, 10};
+      CHECK(rose.setSpeedClasses(three, 2));
+    }
+    CHECK(rose.setSectors(sectors));
+    uint8_t classes = rose.getClassCount();
+    std::vector<uint32_t> expected(sectors * classes, 0);
+    const uint32_t samples = 50000;
+    for (uint32_t n = 0; n < samples; n++)
+    {
+      uint16_t dir = random() % 360;
+      float speed = (random() % 2000) / 100.0f;
+      int speed_class = 0;
+      while (speed_class < classes - 1 && speed >= rose.getClassLimit(speed_class))
+      {
+        speed_class++;
+      }
+      if (classes == 6)
+      {
+        CHECK(speed_class == referenceClass(speed));
+      }
+      expected[referenceSector(dir, sectors) * classes + speed_class]++;
+      rose.add(speed, dir, 1000 + n);
+    }
+    int mismatches = 0;
+    for (int sector = 0; sector < sectors; sector++)
+    {
+      for (int speed_class = 0; speed_class < classes; speed_class++)
+      {
+        if (rose.getCount(sector, speed_class) != expected[sector * classes + speed_class])
+        {
+          mismatches++;
+        }
+      }
+    }
+    CHECK(mismatches == 0);
+    CHECK(rose.getSampleCount() == samples);
+    CHECK(rose.getLastSampleSeq() == 1000 + samples - 1);
+  }
+}
+
+// a bin stops at 65535, the sample count and the other bins go on
+static void testSaturation()
+{
+  WN_WIND_ROSE rose;
+  const uint32_t samples = 70000;
+  for (uint32_t n = 0; n < samples; n++)
+  {
+    rose.add(5, 2, n);
+  }
+  rose.add(5, 90, samples);
+  CHECK(rose.getCount(0, 2) == UINT16_MAX);
+  CHECK(rose.getCount(4, 2) == 1);
+  CHECK(rose.getCount(0, 1) == 0 && rose.getCount(0, 3) == 0 && rose.getCount(15, 2) == 0);
+  CHECK(rose.getSampleCount() == samples + 1);
+
+  // a snapshot keeps the counts, reset() clears them but keeps sectors and classes
+  WN_WIND_ROSE copy;
+  rose.snapshot(&copy);
+  rose.reset();
+  CHECK(copy.getCount(0, 2) == UINT16_MAX && copy.getSampleCount() == samples + 1);
+  CHECK(rose.getCount(0, 2) == 0 && rose.getSampleCount() == 0);
+  CHECK(rose.getSectorCount() == WIND_ROSE_DEFAULT_SECTORS && rose.getClassCount() == 6);
+}
+
+static void testSettings()
+{
+  WN_WIND_ROSE rose;
+  CHECK(!rose.setSectors(0));
+  CHECK(!rose.setSectors(WIND_ROSE_MAX_SECTORS + 1));
+  CHECK(!rose.setSectors(WIND_ROSE_MAX_SECTORS)); // 36 x 6 bins don't fit
+  CHECK(rose.getSectorCount() == WIND_ROSE_DEFAULT_SECTORS);
+  const float many[WIND_ROSE_MAX_CLASSES] = {1, 2, 3, 4, 5, 6, 7, 8};
+  CHECK(!rose.setSpeedClasses(many, WIND_ROSE_MAX_CLASSES));
+  CHECK(!rose.setSpeedClasses(many, WIND_ROSE_MAX_CLASSES - 1)); // 16 x 8 bins don't fit
+  CHECK(rose.setSectors(8));
+  CHECK(rose.setSpeedClasses(many, WIND_ROSE_MAX_CLASSES - 1));
+  CHECK(rose.getClassCount() == WIND_ROSE_MAX_CLASSES);
+  CHECK(!rose.setSectors(16));
+  CHECK(rose.setSpeedClasses(many, 2));
+  CHECK(rose.setSectors(WIND_ROSE_MAX_SECTORS));
+  CHECK(rose.getClassCount() == 3 && rose.getClassLimit(1) == 2 && rose.getClassLimit(2) == 0);
+  CHECK(rose.getCount(WIND_ROSE_MAX_SECTORS, 0) == 0 && rose.getCount(0, 3) == 0);
+}
+
+int main()
+{
+  testSectors();
+  testSpeedClasses();
+  testRecount();
+  testSaturation();
+  testSettings();
+  TEST_END();
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Window reports built from history records and the edges of the window, against the loop over every
+// sample of the window they replaced, for 1, 10 and 20 minutes windows, then the cost of both.
+
+#include "test.h"
+#include "core_access.h"
+#include <chrono>
+#include <random>
+
+// the report loop before history records: every sample of the window, unpacked one by one
+static wn_raw_wind_report_t perSampleReport(WN_Core &core, uint32_t shift, uint16_t samples_to_average)
+{
+  WN_VECTOR_AVERAGER averager;
+  for (uint32_t i = shift; i < shift + samples_to_average; i++)
+  {
+    wn_raw_wind_sample_t sample = core.RollingBuffer.get(i);
+    if (sample.valid)
+    {
+      averager.accumulate(sample);
+    }
+  }
+  wn_raw_wind_report_t report;
+  averager.computeReportFromAccumulatedValues(&report);
+  return report;
+}
+
+static wn_raw_wind_report_t rangeReport(WN_Core &core, uint32_t shift, uint16_t samples_to_average)
+{
+  WN_VECTOR_AVERAGER averager;
+  core.RollingBuffer.accumulateRange(averager, shift, samples_to_average);
+  wn_raw_wind_report_t report;
+  averager.computeReportFromAccumulatedValues(&report);
+  return report;
+}
+
+static std::mt19937 random_source(11);
+static int walk_pulses = 60, walk_dir = 200;
+
+static void feedWalk(WN_Core &core, int samples)
+{
+  for (int i = 0; i < samples; i++)
+  {
+    walk_pulses = std::max(0, std::min(400, walk_pulses + (int)(random_source() % 21) - 10));
+    walk_dir = (walk_dir + (int)(random_source() % 61) - 30 + 360) % 360;
+    feedSample(core, walk_pulses, walk_dir);
+  }
+}
+
+// closed minutes are merged as Q6 means, rounded again when folded into 10 minutes, so each component of the
+// mean may differ by 2/128 pulse (0.022 pulse, 0.01 m/s on the mean) and the direction by the rounding to a
+// degree; minimum and maximum are exact
+static void testAgainstPerSampleLoop()
+{
+  WN_Core core;
+  int speed_errors = 0, dir_errors = 0, extreme_errors = 0, compared = 0;
+  double worst_speed = 0;
+  feedWalk(core, 45);
+  for (int round = 0; round < 400; round++)
+  {
+    feedWalk(core, 1 + random_source() % 7); // window ends anywhere in the minute in progress
+    for (uint16_t minutes : {1, 10, 20})
+    {
+      uint16_t samples_to_average = minutes * SAMPLES_PER_MINUTE;
+      for (uint32_t shift : {0u, 1u, 13u, 20u, (uint32_t)(random_source() % ROLLING_BUFFER_LENGTH)})
+      {
+        if (shift + samples_to_average > core.RollingBuffer.getTotalSamples() || shift + samples_to_average > ROLLING_BUFFER_LENGTH)
+          continue;
+        wn_raw_wind_report_t expected = perSampleReport(core, shift, samples_to_average);
+        wn_raw_wind_report_t got = rangeReport(core, shift, samples_to_average);
+        compared++;
+        double speed_error = fabs(got.pulses_avg - expected.pulses_avg);
+        worst_speed = std::max(worst_speed, speed_error);
+        if (speed_error > 2 * M_SQRT2 / 128)
+          speed_errors++;
+        int dir_error = abs(got.dir_avg - expected.dir_avg);
+        dir_error = dir_error > 180 ? 360 - dir_error : dir_error;
+        // the direction of a short resultant moves with the rounding of its components
+        if (expected.pulses_avg >= 2 && dir_error > 1)
+          dir_errors++;
+        if (got.pulses_min != expected.pulses_min || got.pulses_max != expected.pulses_max)
+          extreme_errors++;
+      }
+    }
+  }
+  CHECK(compared > 3000);
+  CHECK(speed_errors == 0);
+  CHECK(dir_errors == 0);
+  CHECK(extreme_errors == 0);
+  printf("  %d windows against the per-sample loop: worst mean difference %.4f pulse\n", compared, worst_speed);
+}
+
+static void benchmark()
+{
+  WN_Core core;
+  feedWalk(core, ROLLING_BUFFER_LENGTH + 7);
+  const int reps = 20000;
+  volatile float sink = 0;
+  for (uint16_t minutes : {1, 10, 20})
+  {
+    uint16_t period = minutes * 60;
+    uint16_t samples_to_average = minutes * SAMPLES_PER_MINUTE;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++)
+    {
+      wn_raw_wind_report_t raw = perSampleReport(core, 0, samples_to_average);
+      sink += core.formatRawReport(raw).avg_speed;
+    }
+    double loop_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / reps;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; i++)
+      sink += core.computeReportForPeriodInSecIndexedFromLast(period, 0).avg_speed;
+    double range_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / reps;
+    printf("  %2u minutes window: %6.0f ns per report, %5.0f ns with history records on this host\n", minutes, loop_ns, range_ns);
+  }
+}
+
+int main()
+{
+  testAgainstPerSampleLoop();
+  benchmark();
+  TEST_END();
+}
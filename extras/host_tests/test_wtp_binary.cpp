@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// CRC-16 and varint encodings, then binary payloads decoded by extras/wtp_binary_decoder.py
+// and compared line by line with the text payload of the same wind. Needs python3 for the round trip.
+
+#include "test.h"
+#include "core_access.h"
+#include "Windnerd_Wtp_Payload.h"
+#include "Windnerd_Wtp_Writer.h"
+#include "Windnerd_Crc.h"
+#include <map>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+static void testCrc()
+{
+  // CRC-16/CCITT-FALSE check value
+  const char *check = "123456789";
+  CHECK(wn_crc16((const uint8_t *)check, 9) == 0x29B1);
+  uint16_t crc = WN_CRC16_INIT;
+  for (int i = 0; i < 9; i++) crc = wn_crc16_update(crc, check[i]);
+  CHECK(crc == 0x29B1);
+  CHECK(wn_crc16(NULL, 0) == 0xFFFF);
+}
+
+static std::string encoded(void (*encode)(WN_WTP_WRITER &, int64_t), int64_t value)
+{
+  StringPrint out;
+  WN_WTP_WRITER writer(&out);
+  encode(writer, value);
+  writer.flush();
+  return out.s;
+}
+
+static void testVarints()
+{
+  auto varint = [](WN_WTP_WRITER &w, int64_t v) { w.writeVarint((uint32_t)v); };
+  auto zigzag = [](WN_WTP_WRITER &w, int64_t v) { w.writeZigzag((int32_t)v); };
+  CHECK(encoded(varint, 0) == std::string("\x00", 1));
+  CHECK(encoded(varint, 127) == "\x7f");
+  CHECK(encoded(varint, 128) == "\x80\x01");
+  CHECK(encoded(varint, 300) == "\xac\x02");
+  CHECK(encoded(varint, UINT32_MAX) == "\xff\xff\xff\xff\x0f");
+  CHECK(encoded(zigzag, -1) == "\x01");
+  CHECK(encoded(zigzag, 1) == "\x02");
+  CHECK(encoded(zigzag, INT32_MAX) == "\xfe\xff\xff\xff\x0f");
+  CHECK(encoded(zigzag, INT32_MIN) == "\xff\xff\xff\xff\x0f");
+}
+
+// "r,wa=1.5,wd=20" -> {"wa": 1.5, "wd": 20}, lines of one kind in order
+typedef std::map<std::string, std::string> Fields;
+static std::vector<Fields> linesOf(const std::string &payload, char kind)
+{
+  std::vector<Fields> lines;
+  size_t start = 0;
+  while (start < payload.size())
+  {
+    size_t end = payload.find(';', start);
+    if (end == std::string::npos) break;
+    std::string line = payload.substr(start, end - start);
+    start = end + 1;
+    while (!line.empty() && (line[0] == '\n' || line[0] == '\r')) line.erase(0, 1);
+    if (line.size() < 2 || line[0] != kind || line[1] != ',') continue;
+    Fields fields;
+    size_t pos = 2;
+    while (pos <= line.size())
+    {
+      size_t comma = line.find(',', pos);
+      if (comma == std::string::npos) comma = line.size();
+      std::string item = line.substr(pos, comma - pos);
+      size_t equal = item.find('=');
+      fields[item.substr(0, equal)] = item.substr(equal + 1);
+      pos = comma + 1;
+    }
+    lines.push_back(fields);
+  }
+  return lines;
+}
+
+static std::string runDecoder(const std::string &binary, const char *secret_key, int *status)
+{
+  char path[] = "/tmp/wtp_binaryXXXXXX";
+  int fd = mkstemp(path);
+  CHECK(write(fd, binary.data(), binary.size()) == (ssize_t)binary.size());
+  close(fd);
+  std::string command = std::string("python3 ../wtp_binary_decoder.py ") + path + " " + (secret_key ? secret_key : "") + " 2>/dev/null";
+  FILE *pipe = popen(command.c_str(), "r");
+  std::string output;
+  char buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) output.append(buffer, n);
+  *status = pclose(pipe);
+  unlink(path);
+  return output;
+}
+
+// every field of the text payload must be found in the decoded binary payload, sample speeds within tolerance
+static int compareLines(const std::string &text, const std::string &decoded, char kind, double speed_tolerance)
+{
+  std::vector<Fields> expected = linesOf(text, kind);
+  std::vector<Fields> got = linesOf(decoded, kind);
+  CHECK(expected.size() == got.size());
+  int differences = 0;
+  for (size_t i = 0; i < expected.size() && i < got.size(); i++)
+  {
+    for (auto &field : expected[i])
+    {
+      if (!got[i].count(field.first))
+      {
+        differences++;
+        continue;
+      }
+      const std::string &value = got[i][field.first];
+      double tolerance = field.first == "wi" ? speed_tolerance : 1e-6;
+      bool same = field.first == "mt" ? value == field.second : fabs(atof(value.c_str()) - atof(field.second.c_str())) <= tolerance;
+      if (!same && differences++ < 5)
+        printf("  %c line %zu %s: text %s, binary %s\n", kind, i, field.first.c_str(), field.second.c_str(), value.c_str());
+    }
+  }
+  return differences;
+}
+
+static void testRoundTrip()
+{
+  if (system("python3 -c 'import hashlib' >/dev/null 2>&1") != 0)
+  {
+    printf("  python3 not found, round trip skipped\n");
+    return;
+  }
+  char key[] = "3122fd880084fd55";
+  int payloads = 0;
+  for (int seed = 0; seed < 12; seed++)
+  {
+    std::mt19937 random(seed);
+    WN_Core core;
+    core.setSpeedUnit((wn_wind_unit_t)(seed % 4));
+    int pulses = random() % 300, dir = random() % 360;
+    for (int i = 0; i < 400; i++)
+    {
+      pulses = std::max(0, std::min(600, pulses + (int)(random() % 21) - 10));
+      if (random() % 50 == 0) pulses = random() % 600;
+      dir = (dir + (int)(random() % 41) - 20 + 360) % 360;
+      feedSample(core, pulses, dir);
+    }
+
+    WN_WTP_PAYLOAD payload;
+    payload.reset();
+    payload.setAnemometer(&core);
+    payload.setPeriodInMinutes(10);
+    payload.setSecretKey(key);
+    payload.enableWindSamples();
+    payload.setVoltage(3.86f);
+    payload.setTemperature(-3.2f - seed);
+    payload.setHumidity(70);
+    payload.setPressure(1012.3f);
+    payload.setRSSI(-71.5f);
+    payload.setMeta("no error");
+    StringPrint text;
+    payload.sendPayload(&text);
+
+    bool signing = seed % 2;
+    if (signing) payload.enableHmacSigning();
+    payload.enableBinaryEncoding();
+    unsigned int length = payload.calculatePayloadLength();
+    StringPrint binary;
+    payload.sendPayload(&binary);
+    CHECK(length == binary.s.size());
+
+    int status;
+    std::string decoded = runDecoder(binary.s, signing ? key : NULL, &status);
+    CHECK(status == 0);
+    // samples travel as pulses: the decoder rounds pulses * speed per pulse, which may land on the
+    // other side of a rounding tie than the speed computed on the device, one last digit away
+    CHECK(compareLines(text.s, decoded, 'r', 0) == 0);
+    CHECK(compareLines(text.s, decoded, 'l', 0) == 0);
+    CHECK(compareLines(text.s, decoded, 's', 0.1 + 1e-6) == 0);
+    CHECK(!linesOf(decoded, 's').empty());
+    payloads++;
+
+    if (signing)
+    {
+      std::string tampered = binary.s;
+      tampered[40] ^= 1;
+      runDecoder(tampered, key, &status);
+      CHECK(status != 0);
+    }
+  }
+  printf("  %d payloads decoded and compared with their text version\n", payloads);
+}
+
+// values without a binary encoding: nan is sent as 0, the rest is clamped to 32 bits
+static void testSpecialValues()
+{
+  if (system("python3 -c 'import hashlib' >/dev/null 2>&1") != 0) return;
+  WN_Core core;
+  for (int i = 0; i < 40; i++) feedSample(core, 10, 10);
+  char key[] = "3122fd880084fd55";
+  WN_WTP_PAYLOAD payload;
+  payload.reset();
+  payload.setAnemometer(&core);
+  payload.setSecretKey(key);
+  payload.setTemperature(NAN);
+  payload.setPressure(1e20f);
+  payload.setVoltage(-INFINITY);
+  payload.enableBinaryEncoding();
+  StringPrint binary;
+  payload.sendPayload(&binary);
+  int status;
+  std::string decoded = runDecoder(binary.s, NULL, &status);
+  CHECK(status == 0);
+  std::vector<Fields> reports = linesOf(decoded, 'r');
+  std::vector<Fields> log = linesOf(decoded, 'l');
+  CHECK(reports.size() == 1 && log.size() == 1);
+  if (reports.size() == 1 && log.size() == 1)
+  {
+    CHECK(atof(reports[0]["tp"].c_str()) == 0);
+    CHECK(atof(reports[0]["pr"].c_str()) == INT32_MAX / 10.0);
+    CHECK(atof(log[0]["vo"].c_str()) == INT32_MIN / 100.0);
+  }
+}
+
+int main()
+{
+  testCrc();
+  testVarints();
+  testRoundTrip();
+  testSpecialValues();
+  TEST_END();
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// WN_WTP_WRITER number formatting against snprintf, values printf can't give (nan, inf, beyond 32 bits),
+// and a full text payload composed without any heap allocation. Compose time is printed, host only.
+
+#include "test.h"
+#include "core_access.h"
+#include "Windnerd_Wtp_Payload.h"
+#include "Windnerd_Wtp_Writer.h"
+#include <cfloat>
+#include <chrono>
+#include <new>
+#include <random>
+
+// allocations are counted while counting is set, malloc through glibc's own entry point
+static bool counting = false;
+static int allocations = 0;
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *malloc(size_t size)
+{
+  if (counting) allocations++;
+  return __libc_malloc(size);
+}
+void *operator new(size_t size)
+{
+  if (counting) allocations++;
+  return __libc_malloc(size);
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static std::string printFloat(float value, uint8_t decimals)
+{
+  StringPrint out;
+  WN_WTP_WRITER writer(&out);
+  writer.printFloat(value, decimals);
+  writer.flush();
+  return out.s;
+}
+
+static std::string printScaled(int32_t value, uint8_t decimals)
+{
+  StringPrint out;
+  WN_WTP_WRITER writer(&out);
+  writer.printScaled(value, decimals);
+  writer.flush();
+  return out.s;
+}
+
+// the writer rounds after a float multiply, so within a float step of a tie it may round the other way
+// than printf's exact decimal conversion, those values are skipped
+static bool isTie(float value, uint8_t decimals)
+{
+  double scaled = fabs((double)value) * pow(10, decimals);
+  return fabs(scaled - floor(scaled) - 0.5) <= 2 * scaled * FLT_EPSILON;
+}
+
+static void testAgainstPrintf()
+{
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> range(-2000.0f, 2000.0f);
+  int compared = 0, differences = 0;
+  for (int i = 0; i < 200000; i++)
+  {
+    float value = i < 100000 ? range(random) : ldexpf(range(random), -(int)(random() % 12));
+    uint8_t decimals = random() % 3;
+    if (isTie(value, decimals)) continue;
+    char expected[48];
+    snprintf(expected, sizeof(expected), "%.*f", decimals, value);
+    compared++;
+    if (printFloat(value, decimals) != expected)
+    {
+      if (differences++ < 5) printf("  %.9g/%u: %s vs %s\n", value, decimals, printFloat(value, decimals).c_str(), expected);
+    }
+  }
+  CHECK(differences == 0);
+  printf("  %d values compared with snprintf\n", compared);
+}
+
+static void testSpecialValues()
+{
+  CHECK_EQUAL_STRING(printFloat(0.0f, 1).c_str(), "0.0");
+  CHECK_EQUAL_STRING(printFloat(-0.04f, 1).c_str(), "-0.0");
+  CHECK_EQUAL_STRING(printFloat(12.34f, 0).c_str(), "12");
+  CHECK_EQUAL_STRING(printFloat(3.856f, 2).c_str(), "3.86");
+  CHECK_EQUAL_STRING(printFloat(NAN, 1).c_str(), "nan");
+  CHECK_EQUAL_STRING(printFloat(-NAN, 1).c_str(), "nan");
+  CHECK_EQUAL_STRING(printFloat(INFINITY, 2).c_str(), "inf");
+  CHECK_EQUAL_STRING(printFloat(-INFINITY, 0).c_str(), "-inf");
+  // clamped to 32 bits of magnitude
+  CHECK_EQUAL_STRING(printFloat(1e12f, 1).c_str(), "429496729.5");
+  CHECK_EQUAL_STRING(printFloat(-1e30f, 0).c_str(), "-4294967295");
+  CHECK_EQUAL_STRING(printFloat(FLT_MAX, 2).c_str(), "42949672.95");
+  CHECK_EQUAL_STRING(printFloat(4294967040.0f, 0).c_str(), "4294967040");
+  CHECK_EQUAL_STRING(printScaled(INT32_MIN, 1).c_str(), "-214748364.8");
+  CHECK_EQUAL_STRING(printScaled(INT32_MAX, 0).c_str(), "2147483647");
+  CHECK_EQUAL_STRING(printScaled(-5, 2).c_str(), "-0.05");
+}
+
+static void testPayload()
+{
+  WN_Core core;
+  for (int i = 0; i < 1300; i++)
+  {
+    feedSample(core, 100 + (i * 37) % 200, (i * 53) % 360);
+  }
+  char key[] = "3122fd880084fd55";
+  WN_WTP_PAYLOAD payload;
+  auto compose = [&](Print *out) {
+    payload.reset();
+    payload.setAnemometer(&core);
+    payload.setPeriodInMinutes(20);
+    payload.setSecretKey(key);
+    payload.enableWindSamples();
+    payload.setTemperature(NAN);
+    payload.setVoltage(3.86f);
+    payload.setPressure(INFINITY);
+    payload.setMeta("no error");
+    unsigned int length = payload.calculatePayloadLength();
+    payload.sendPayload(out);
+    return length;
+  };
+
+  StringPrint out;
+  out.s.reserve(16384);
+  counting = true;
+  unsigned int length = compose(&out);
+  counting = false;
+  CHECK(allocations == 0);
+  CHECK(length == out.s.size());
+  CHECK(out.s.find(",tp=nan") != std::string::npos);
+  CHECK(out.s.find(",pr=inf") != std::string::npos);
+
+  struct NullPrint : Print
+  {
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+  } null;
+  const int repeats = 2000;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeats; i++)
+  {
+    compose(&null);
+  }
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+  printf("  %u bytes payload, 20 reports and 400 samples: %d allocations, %.1f us to size and send on this host\n", length, allocations, us);
+}
+
+int main()
+{
+  testAgainstPrintf();
+  testSpecialValues();
+  testPayload();
+  TEST_END();
+}
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026, windnerd.net
+# All rights reserved.
+#
+# This source code is licensed under the BSD 3-Clause License found in the
+# LICENSE file in the root directory of this source tree.
+#
+# Reference decoder of the binary WTP encoding described in docs/WTP.md.
+# Usage: wtp_binary_decoder.py payload.bin [secret_key]   (prints the equivalent text payload)
+# The secret key is needed to verify a signed payload.
+
+import hashlib
+import hmac
+import struct
+import sys
+
+UNITS = ["ms", "kn", "kmh", "mph"]
+
+# flag, text field, decimals, in the order values are written
+FIELDS = [
+    (0x01, "tp", 1),
+    (0x02, "hu", 0),
+    (0x04, "pr", 1),
+    (0x08, "vo", 2),
+    (0x10, "rs", 1),
+    (0x20, "ti", 1),
+]
+META = 0x40
+SIGNED = 0x80
+MAC_SIZE = 32
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def bytes(self, length):
+        if self.pos + length > len(self.data):
+            raise ValueError("truncated payload")
+        chunk = self.data[self.pos:self.pos + length]
+        self.pos += length
+        return chunk
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.bytes(1)[0]
+            value |= (byte & 0x7F) << shift
+            if not byte & 0x80:
+                return value
+            shift += 7
+            if shift > 28:
+                raise ValueError("varint too long")
+
+    def zigzag(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+
+def key_id(secret_key):
+    return hashlib.sha256(secret_key.encode("ascii")).digest()[:8]
+
+
+def decode(data, secret_key=None):
+    if len(data) < 19 or data[0:2] != b"WB":
+        raise ValueError("not a binary WTP payload")
+    if crc16(data[:-2]) != struct.unpack("<H", data[-2:])[0]:
+        raise ValueError("CRC mismatch")
+    # version 2 adds sequence numbers to incremental payloads
+    if data[2] not in (1, 2):
+        raise ValueError("unsupported version %d" % data[2])
+    sequenced = data[2] == 2
+    flags = data[16]
+    payload = {}
+
+    body = data[:-2]
+    if flags & SIGNED:
+        body, mac = body[:-MAC_SIZE], body[-MAC_SIZE:]
+        payload["key_id"] = data[3:11].hex()
+        if secret_key is not None:
+            if key_id(secret_key) != data[3:11]:
+                raise ValueError("payload signed with another key")
+            if not hmac.compare_digest(hmac.new(secret_key.encode("ascii"), body, hashlib.sha256).digest(), mac):
+                raise ValueError("wrong signature")
+            payload["verified"] = True
+
+    reader = Reader(body)
+    reader.bytes(3)
+    key = reader.bytes(8).hex()
+    if not flags & SIGNED:
+        payload["key"] = key
+    unit = reader.bytes(1)[0]
+    payload["wind_unit"] = UNITS[unit] if unit < len(UNITS) else unit
+    (speed_per_pulse,) = struct.unpack("<f", reader.bytes(4))
+    reader.bytes(1)
+    payload["fields"] = {}
+    for flag, name, decimals in FIELDS:
+        if flags & flag:
+            payload["fields"][name] = reader.zigzag() / 10 ** decimals
+    if flags & META:
+        payload["fields"]["mt"] = reader.bytes(reader.varint()).decode("ascii")
+
+    payload["reports"] = []
+    count = reader.varint()
+    if sequenced and count > 0:
+        payload["mq"] = reader.varint()
+        payload["ma"] = reader.varint()
+    for _ in range(count):
+        avg, low, high, direction = (reader.varint() for _ in range(4))
+        payload["reports"].append({"wa": avg / 10, "wn": low / 10, "wx": high / 10, "wd": direction})
+
+    payload["samples"] = []
+    pulses = 0
+    direction = 0
+    count = reader.varint()
+    if sequenced and count > 0:
+        payload["sq"] = reader.varint()
+        payload["sa"] = reader.varint()
+    for _ in range(count):
+        pulses += reader.zigzag()
+        direction = (direction + reader.zigzag()) % 360
+        payload["samples"].append({"wi": round(pulses * speed_per_pulse, 1), "wd": direction, "pulses": pulses})
+
+    if reader.pos != len(reader.data):
+        raise ValueError("%d unexpected trailing bytes" % (len(reader.data) - reader.pos))
+    return payload
+
+
+def to_text(payload):
+    if "key" in payload:
+        lines = ["k=%s,wu=%s" % (payload["key"], payload["wind_unit"])]
+    else:
+        lines = ["ki=%s,wu=%s" % (payload["key_id"], payload["wind_unit"])]
+    for field in ("mq", "ma", "sq", "sa"):
+        if field in payload:
+            lines[0] += ",%s=%d" % (field, payload[field])
+    env = {k: v for k, v in payload["fields"].items() if k in ("tp", "hu", "pr")}
+    log = {k: v for k, v in payload["fields"].items() if k in ("vo", "rs", "ti", "mt")}
+    for i, report in enumerate(payload["reports"]):
+        values = dict(report, **env) if i == 0 else report
+        lines.append("r," + ",".join("%s=%s" % (k, v) for k, v in values.items()))
+    if log:
+        lines.append("l," + ",".join("%s=%s" % (k, v) for k, v in log.items()))
+    for sample in payload["samples"]:
+        lines.append("s,wi=%s,wd=%s" % (sample["wi"], sample["wd"]))
+    return ";\n".join(lines) + ";"
+
+
+if __name__ == "__main__":
+    with open(sys.argv[1], "rb") as f:
+        print(to_text(decode(f.read(), sys.argv[2] if len(sys.argv) > 2 else None)))
@@ -12,6 +12,7 @@
 #include <Wire.h>
 
 HardwareTimer *tickerTimer = nullptr;
+HardwareTimer *pulseCounterTimer = nullptr;
 
 // frequency to speed ratio for standard rotor
 #define HZ_TO_MS 1.31
@@ -21,25 +22,80 @@ HardwareTimer *tickerTimer = nullptr;
 // default time between wind avg update in seconds
 #define DEFAULT_UPDATE_PERIOD_SEC 60
 
-// 30 ticks at 10 HZ -> speed pulses are counted for each 3 sec periods
-#define TICK_HZ 10
-#define SAMPLING_WINDOW_TICKS 30
-#define SAMPLE_DURATION (SAMPLING_WINDOW_TICKS / TICK_HZ)
+// speed pulses are counted for each 3 sec periods
+#define SAMPLE_DURATION 3
+#define SAMPLE_DURATION_MS (SAMPLE_DURATION * 1000UL)
+#define SAMPLE_DURATION_US (SAMPLE_DURATION_MS * 1000UL)
+// windows missed while the user program loop was blocked are caught up to this limit, older ones are lost
+#define MAX_CATCH_UP_SAMPLES SAMPLES_PER_MINUTE
 
-// in low power mode, measure vane angle every 500 ms
-#define LOW_POWER_VANE_TICKS 5
+// input capture timestamps pulses at 0.1 ms resolution, 16 bits periods up to 6.5 sec
+#define CAPTURE_TIMER_HZ 10000
+#define CAPTURE_MAX_PERIOD_MS 6000
+#define CAPTURE_MIN_PERIOD_TICKS (CAPTURE_TIMER_HZ / 100) // shorter periods (> 130 m/s) are contact bounces
+// periods waiting to be read by loop(), 12 are expected between two vane measurements in low power mode at 30 m/s
+#define CAPTURE_RING_LENGTH 32
 
-static volatile bool wn_ticker = false;         // flag to indicate that a tick interrupt has happened
-static volatile uint32_t speed_pulse_count = 0; // to be incremented by rising edge interrupts on speed pulse input
+// measure vane angle every 100 ms, every 500 ms in low power mode
+#define VANE_PERIOD_MS 100
+#define LOW_POWER_VANE_PERIOD_MS 500
+
+// the wakeup timer counts milliseconds, so the longest wait fits a 16 bits timer
+#define WAKEUP_TIMER_HZ 1000
+#define MAX_WAKEUP_MS 0xFFFF
+
+static volatile bool wn_ticker = false;         // flag to indicate that the wakeup timer interrupt has happened
+// the ISR only increments a free running total and the loop takes deltas, so no pulse is lost between
+// a read and a reset, without masking interrupts (32 bits reads are atomic, wraparound is harmless)
+static volatile uint32_t isr_pulse_total = 0;  // incremented by rising edge interrupts on speed pulse input
+static uint32_t last_isr_pulse_total = 0;      // total at previous read
+static uint32_t window_pulse_count = 0;        // pulses of the sampling window in progress, loop side only
 static volatile bool low_power_mode = false;
 static volatile uint8_t isr_speed_led_pin = CORE_SPEED_LED_PIN;
+static uint16_t last_pulse_counter_value = 0; // hardware counter value at previous read
+
+// rotor periods from input capture, single producer (ISR) single consumer (loop) ring, no masking needed
+static HardwareTimer *pulseCaptureTimer = nullptr;
+static uint32_t capture_channel = 0;
+static volatile uint16_t isr_periods[CAPTURE_RING_LENGTH];
+static volatile uint32_t isr_period_head = 0; // periods written since start, only the ISR writes it
+static uint32_t period_tail = 0;              // periods read since start, only the loop writes it
+static uint16_t last_capture = 0;
+static uint32_t last_capture_millis = 0;
+static bool has_last_capture = false;
 
 
 void onSpeedPulseISR()
 {
   if (!low_power_mode)
-    digitalWrite(isr_speed_led_pin, HIGH); // signal pulse by turning the speed LED ON, it will be turned OFF during the next tick
-  speed_pulse_count++;
+    digitalWrite(isr_speed_led_pin, HIGH); // signal pulse by turning the speed LED ON, it will be turned OFF at the next vane measurement
+  isr_pulse_total++;
+}
+
+// Pulse timestamped by the capture timer: counted like onSpeedPulseISR(), and the period since the previous
+// pulse is queued for loop(). The first pulse after a long stop only starts a new period.
+void onSpeedCaptureISR()
+{
+  if (!pulseCaptureTimer)
+  {
+    return;
+  }
+  uint16_t capture = pulseCaptureTimer->getCaptureCompare(capture_channel, TICK_FORMAT);
+  uint32_t now = millis();
+  if (has_last_capture && now - last_capture_millis < CAPTURE_MAX_PERIOD_MS)
+  {
+    uint16_t period = capture - last_capture;
+    if (period < CAPTURE_MIN_PERIOD_TICKS)
+    {
+      return; // bounce, neither counted nor timestamped
+    }
+    isr_periods[isr_period_head % CAPTURE_RING_LENGTH] = period;
+    isr_period_head++;
+  }
+  last_capture = capture;
+  last_capture_millis = now;
+  has_last_capture = true;
+  isr_pulse_total++;
 }
 
 void onTickerTimerISR()
@@ -47,23 +103,89 @@ void onTickerTimerISR()
   wn_ticker = true;
 }
 
+// Timer and channel the speed input is routed to, NP when there is none besides the wakeup timer
+static TIM_TypeDef *speedInputTimer(uint8_t pin, uint32_t *channel)
+{
+  PinName pin_name = digitalPinToPinName(pin);
+  TIM_TypeDef *instance = (TIM_TypeDef *)pinmap_peripheral(pin_name, PinMap_TIM);
+  if (instance == NP || instance == TIM3) // TIM3 is the wakeup timer
+  {
+    return (TIM_TypeDef *)NP;
+  }
+  *channel = STM_PIN_CHANNEL(pinmap_function(pin_name, PinMap_TIM));
+  return instance;
+}
+
+// Use the speed input as external clock of the timer it is routed to, so pulses are counted
+// by hardware without waking the core. Only timer channels 1 and 2 can clock a counter.
+// Returns nullptr when the pin cannot be used that way.
+static HardwareTimer *startPulseCounterTimer(uint8_t pin)
+{
+  uint32_t channel = 0;
+  TIM_TypeDef *instance = speedInputTimer(pin, &channel);
+  if (instance == NP || (channel != 1 && channel != 2))
+  {
+    return nullptr;
+  }
+
+  HardwareTimer *counter = new HardwareTimer(instance);
+  counter->setMode(channel, TIMER_INPUT_CAPTURE_RISING, pin);
+  counter->setPrescaleFactor(1);
+  counter->setOverflow(0x10000, TICK_FORMAT); // free running, 16 bits deltas are wraparound safe
+
+  TIM_SlaveConfigTypeDef slave_config = {0};
+  slave_config.SlaveMode = TIM_SLAVEMODE_EXTERNAL1;
+  slave_config.InputTrigger = (channel == 1) ? TIM_TS_TI1FP1 : TIM_TS_TI2FP2;
+  slave_config.TriggerPolarity = TIM_TRIGGERPOLARITY_RISING;
+  HAL_TIM_SlaveConfigSynchro(counter->getHandle(), &slave_config);
+
+  counter->setCount(0);
+  counter->resume();
+  return counter;
+}
+
+// Timestamp speed input pulses with the capture unit of the timer it is routed to, any channel.
+// One short interrupt per pulse reads the captured time. Returns false when the pin has no timer.
+static bool startPulseCaptureTimer(uint8_t pin)
+{
+  TIM_TypeDef *instance = speedInputTimer(pin, &capture_channel);
+  if (instance == NP)
+  {
+    return false;
+  }
+
+  HardwareTimer *capture = new HardwareTimer(instance);
+  capture->setMode(capture_channel, TIMER_INPUT_CAPTURE_RISING, pin);
+  capture->setPrescaleFactor(capture->getTimerClkFreq() / CAPTURE_TIMER_HZ);
+  capture->setOverflow(0x10000, TICK_FORMAT); // free running, 16 bits periods are wraparound safe
+  // the ISR reads the timer, it must be set before the first edge of a spinning rotor
+  pulseCaptureTimer = capture;
+  capture->attachInterrupt(capture_channel, onSpeedCaptureISR);
+  capture->resume();
+  return true;
+}
+
 WN_Core::WN_Core(
     uint8_t speed_led_pin,
     uint8_t north_led_pin,
     uint8_t speed_input_pin,
     uint8_t scl_pin,
-    uint8_t sda_pin
+    uint8_t sda_pin,
+    wn_pulse_counting_t pulse_counting
 )
-    : _speed_led_pin(speed_led_pin),
+    : _HZ_to_ms(HZ_TO_MS),
+      _speed_led_pin(speed_led_pin),
       _north_led_pin(north_led_pin),
       _speed_input_pin(speed_input_pin),
       _scl_pin(scl_pin),
       _sda_pin(sda_pin),
-      _HZ_to_ms(HZ_TO_MS),
+      _pulse_counting(pulse_counting),
+      _angle_sensor_int_pin(NO_ANGLE_SENSOR_INT_PIN),
       _wind_average_period_sec(DEFAULT_AVG_PERIOD_SEC),
       _wind_update_period_sec(DEFAULT_UPDATE_PERIOD_SEC)
 {
   isr_speed_led_pin = _speed_led_pin;
+  RollingBuffer.setExtremesWindow(_wind_average_period_sec / SAMPLE_DURATION);
 }
 
 void WN_Core::begin()
@@ -79,16 +201,47 @@ void WN_Core::begin()
   Wire.setSDA(_sda_pin);
   Wire.setSCL(_scl_pin);
 
-  wn_init_angle_sensor(_scl_pin, _sda_pin);
+  wn_init_angle_sensor(_scl_pin, _sda_pin, _angle_sensor_int_pin);
 
+  if (_wind_log_enabled)
+  {
+    WindLog.begin();
+  }
+
+  // one shot style wakeup timer, reprogrammed by loop() for the next scheduled event
   tickerTimer = new HardwareTimer(TIM3);
-  tickerTimer->setOverflow(TICK_HZ, HERTZ_FORMAT);
+  tickerTimer->setPrescaleFactor(tickerTimer->getTimerClkFreq() / WAKEUP_TIMER_HZ);
+  tickerTimer->setOverflow(VANE_PERIOD_MS, TICK_FORMAT);
+  tickerTimer->refresh();
   tickerTimer->attachInterrupt(onTickerTimerISR);
   tickerTimer->resume();
 
   pinMode(_speed_input_pin, INPUT);
-  attachInterrupt(digitalPinToInterrupt(_speed_input_pin), onSpeedPulseISR, RISING);
-  last_sampling_window_millis = millis();
+  if (_pulse_counting == PULSE_COUNTING_CAPTURE)
+  {
+    if (!startPulseCaptureTimer(_speed_input_pin))
+    {
+      _pulse_counting = PULSE_COUNTING_INTERRUPT;
+    }
+  }
+  if (_pulse_counting == PULSE_COUNTING_TIMER)
+  {
+    pulseCounterTimer = startPulseCounterTimer(_speed_input_pin);
+    if (!pulseCounterTimer)
+    {
+      _pulse_counting = PULSE_COUNTING_INTERRUPT;
+    }
+  }
+  if (_pulse_counting == PULSE_COUNTING_INTERRUPT)
+  {
+    attachInterrupt(digitalPinToInterrupt(_speed_input_pin), onSpeedPulseISR, RISING);
+  }
+
+  uint32_t now = millis();
+  _next_vane_millis = now + VANE_PERIOD_MS;
+  _next_window_millis = now + SAMPLE_DURATION_MS;
+  _window_start_micros = micros();
+  _next_report_millis = now + _wind_update_period_sec * 1000UL;
 }
 
 
@@ -98,6 +251,7 @@ bool WN_Core::setAveragingPeriodInSec(uint16_t period)
   if (period >= SAMPLE_DURATION && period <= ROLLING_BUFFER_LENGTH * SAMPLE_DURATION)
   {
     _wind_average_period_sec = period;
+    RollingBuffer.setExtremesWindow(period / SAMPLE_DURATION);
     return true;
   }
   else
@@ -106,6 +260,186 @@ bool WN_Core::setAveragingPeriodInSec(uint16_t period)
   }
 }
 
+// Report channel 0 to REPORT_CHANNEL_COUNT - 1, a NULL callback disables it. Channels are triggered on sample
+// counts: the interval is a multiple of 3 sec and reports are aligned on it since start, e.g. a 600 sec interval
+// gives reports at each 10 minute mark. A period longer than the rolling buffer is read from the history,
+// both the period and the interval must then be multiples of 60 sec.
+bool WN_Core::setReportChannel(uint8_t channel, uint16_t period, uint16_t interval, void (*cb)(wn_wind_report_t report))
+{
+  if (channel >= REPORT_CHANNEL_COUNT || period < SAMPLE_DURATION || interval < SAMPLE_DURATION || interval % SAMPLE_DURATION != 0)
+  {
+    return false;
+  }
+  if (period > ROLLING_BUFFER_LENGTH * SAMPLE_DURATION && (period % 60 != 0 || interval % 60 != 0))
+  {
+    return false;
+  }
+  _report_channels[channel].period_sec = period;
+  _report_channels[channel].interval_samples = interval / SAMPLE_DURATION;
+  _report_channels[channel].cb = cb;
+  return true;
+}
+
+// called for each new sample. Reports come from the sums of the minute in progress and of the closed minutes,
+// 10 minutes and hours kept by the rolling buffer, so a report aligned on minutes reads a few records
+// whatever its period, only the ends of other periods are read sample by sample.
+void WN_Core::triggerReportChannels()
+{
+  uint32_t total = RollingBuffer.getTotalSamples();
+  for (uint8_t i = 0; i < REPORT_CHANNEL_COUNT; i++)
+  {
+    wn_report_channel_t &channel = _report_channels[i];
+    if (channel.cb && total % channel.interval_samples == 0)
+    {
+      channel.cb(computeReportForRecentPeriodInSec(channel.period_sec));
+    }
+  }
+}
+
+void WN_Core::onWindEvent(void (*cb)(wn_wind_event_t event))
+{
+  windEventCb = cb;
+}
+
+// fire WIND_EVENT_SPEED when the 1 minute mean speed reaches threshold (speed unit in use)
+void WN_Core::setSpeedTrigger(float threshold, float hysteresis)
+{
+  wn_event_trigger_t &trigger = _event_triggers[WIND_EVENT_SPEED];
+  trigger = {};
+  trigger.enabled = true;
+  trigger.threshold = threshold;
+  trigger.hysteresis = hysteresis;
+}
+
+// fire WIND_EVENT_GUST_FACTOR when the current gust reaches ratio x the mean speed of the averaging period,
+// e.g. 1.5, as long as the mean speed is at least min_speed
+void WN_Core::setGustFactorTrigger(float ratio, float hysteresis, float min_speed)
+{
+  wn_event_trigger_t &trigger = _event_triggers[WIND_EVENT_GUST_FACTOR];
+  trigger = {};
+  trigger.enabled = true;
+  trigger.threshold = ratio;
+  trigger.hysteresis = hysteresis;
+  trigger.min_speed = min_speed;
+}
+
+// fire WIND_EVENT_DIRECTION_SHIFT when the mean direction of the last closed minute is more than degrees away
+// from one of the previous minutes (up to MINUTE_REPORT_CACHE_LENGTH - 1), minutes below min_speed are ignored
+bool WN_Core::setDirectionShiftTrigger(uint16_t degrees, uint8_t minutes, uint16_t hysteresis, float min_speed)
+{
+  if (minutes == 0 || minutes >= MINUTE_REPORT_CACHE_LENGTH || degrees > 180)
+  {
+    return false;
+  }
+  wn_event_trigger_t &trigger = _event_triggers[WIND_EVENT_DIRECTION_SHIFT];
+  trigger = {};
+  trigger.enabled = true;
+  trigger.threshold = degrees;
+  trigger.hysteresis = hysteresis;
+  trigger.min_speed = min_speed;
+  trigger.minutes = minutes;
+  return true;
+}
+
+void WN_Core::disableWindEvents()
+{
+  for (uint8_t i = 0; i < WIND_EVENT_TRIGGER_COUNT; i++)
+  {
+    _event_triggers[i] = {};
+  }
+}
+
+// minimum time between two events of the same type, 5 minutes by default
+void WN_Core::setEventMinSpacingSec(uint16_t spacing)
+{
+  _event_min_spacing_samples = spacing / SAMPLE_DURATION;
+}
+
+// called for each new sample, each trigger reads values kept up to date by the rolling buffer and closeMinute()
+void WN_Core::evaluateEventTriggers()
+{
+  uint32_t total = RollingBuffer.getTotalSamples();
+  _minute_pulses_sum += RollingBuffer.get(0).pulses;
+  if (total > SAMPLES_PER_MINUTE)
+  {
+    _minute_pulses_sum -= RollingBuffer.get(SAMPLES_PER_MINUTE).pulses;
+  }
+
+  if (_event_triggers[WIND_EVENT_SPEED].enabled && total >= SAMPLES_PER_MINUTE)
+  {
+    evaluateEventTrigger(WIND_EVENT_SPEED, pulsesToSpeedUnitInUse((float)_minute_pulses_sum / SAMPLES_PER_MINUTE));
+  }
+
+  wn_event_trigger_t &gust_factor = _event_triggers[WIND_EVENT_GUST_FACTOR];
+  if (gust_factor.enabled)
+  {
+    float mean_speed = pulsesToSpeedUnitInUse(RollingBuffer.getWindowMeanPulses());
+    if (mean_speed > 0 && mean_speed >= gust_factor.min_speed)
+    {
+      evaluateEventTrigger(WIND_EVENT_GUST_FACTOR, getCurrentGust() / mean_speed);
+    }
+  }
+
+  // minute means change when a minute closes only
+  wn_event_trigger_t &direction = _event_triggers[WIND_EVENT_DIRECTION_SHIFT];
+  if (direction.enabled && total % SAMPLES_PER_MINUTE == 0)
+  {
+    float min_pulses_q6 = direction.min_speed / pulsesToSpeedUnitInUse(1) * 64;
+    evaluateEventTrigger(WIND_EVENT_DIRECTION_SHIFT, directionShiftOfLastMinute(direction.minutes, min_pulses_q6 < UINT16_MAX ? min_pulses_q6 : UINT16_MAX));
+  }
+}
+
+// hysteresis and spacing common to all triggers
+void WN_Core::evaluateEventTrigger(wn_wind_event_type_t type, float value)
+{
+  wn_event_trigger_t &trigger = _event_triggers[type];
+  if (value < trigger.threshold - trigger.hysteresis)
+  {
+    trigger.armed = true;
+    return;
+  }
+  uint32_t total = RollingBuffer.getTotalSamples();
+  bool spaced = trigger.last_sample == 0 || total - trigger.last_sample >= _event_min_spacing_samples;
+  if (trigger.armed && value >= trigger.threshold && spaced)
+  {
+    trigger.armed = false;
+    trigger.last_sample = total;
+    if (windEventCb)
+    {
+      windEventCb({type, value});
+    }
+  }
+}
+
+// largest direction difference between the last closed minute and the previous ones, 0 if it is too slow
+float WN_Core::directionShiftOfLastMinute(uint8_t minutes, uint16_t min_pulses_q6)
+{
+  const wn_minute_report_t &last = _minute_reports[_closed_minutes % MINUTE_REPORT_CACHE_LENGTH];
+  if (last.pulses_avg < min_pulses_q6)
+  {
+    return 0;
+  }
+  uint16_t shift = 0;
+  for (uint8_t i = 1; i <= minutes && i < _closed_minutes; i++)
+  {
+    const wn_minute_report_t &previous = _minute_reports[(_closed_minutes - i) % MINUTE_REPORT_CACHE_LENGTH];
+    if (previous.pulses_avg < min_pulses_q6)
+    {
+      continue;
+    }
+    uint16_t difference = (last.dir_avg + 360 - previous.dir_avg) % 360;
+    if (difference > 180)
+    {
+      difference = 360 - difference;
+    }
+    if (difference > shift)
+    {
+      shift = difference;
+    }
+  }
+  return shift;
+}
+
 // set the time interval between average wind reports
 bool WN_Core::setReportingIntervalInSec(uint16_t period)
 {
@@ -125,6 +459,13 @@ void WN_Core::invertVanePolarity(bool should_invert)
   _invert_polarity = should_invert;
 }
 
+// optional: pin connected to the angle sensor INT output, so conversion results are read as soon as ready
+// must be called before begin()
+void WN_Core::setAngleSensorIntPin(uint8_t int_pin)
+{
+  _angle_sensor_int_pin = int_pin;
+}
+
 // set an alternative rotor frequency to wind speed ratio (Hz to m/s)
 void WN_Core::setFrequencyToWindSpeedRatio(float ratio)
 {
@@ -145,70 +486,267 @@ void WN_Core::signalIfNorth(uint16_t angle)
   }
 }
 
+void WN_Core::accumulateVaneAngle(uint16_t angle)
+{
+  if (_invert_polarity)
+  {
+    angle = angle + 180;
+  }
+
+  angle = angle % 360; // cap value from 0 to 359
+  signalIfNorth(angle);
+
+  // accumulate with an arbitrary magnitude, we are interested only in direction avg
+  VaneAverager.accumulate((uint32_t)1, angle);
+}
+
+// true once a deadline in millis() time has passed, wraparound safe
+static bool isDue(uint32_t deadline, uint32_t now)
+{
+  return (int32_t)(now - deadline) >= 0;
+}
+
+// next deadline of a periodic event, restarting from now if the event is running late
+static uint32_t nextDeadline(uint32_t deadline, uint32_t period, uint32_t now)
+{
+  deadline += period;
+  return isDue(deadline, now) ? now + period : deadline;
+}
+
 void WN_Core::loop()
 {
 
+  // the vane angle conversion started at a previous event completes in the background
+  uint16_t angle;
+  if (wn_poll_angle_conversion(&angle))
+  {
+    accumulateVaneAngle(angle);
+  }
+
   if (!wn_ticker)
     return;
   wn_ticker = false;
 
-  ticks_cnt++;
+  uint32_t now = millis();
 
-  if (!low_power_mode || ticks_cnt % LOW_POWER_VANE_TICKS == 0)
+  if (isDue(_next_vane_millis, now))
   {
+    wn_start_angle_conversion();
+    updateSpeedLed();
+    _next_vane_millis = nextDeadline(_next_vane_millis, low_power_mode ? LOW_POWER_VANE_PERIOD_MS : VANE_PERIOD_MS, now);
+  }
 
-    uint16_t angle = wn_read_then_make_angle_sensor_sleep();
-
-    if (_invert_polarity)
-    {
-      angle = angle + 180;
-    }
+  if (isDue(_next_window_millis, now))
+  { // counting window has elapsed
+    closeSamplingWindow(now);
+  }
 
-    angle = angle % 360; // cap value from 0 to 359
-    signalIfNorth(angle);
+  if (isDue(_next_report_millis, now))
+  { // time interval between wind avg updates has elapsed
+    wn_wind_report_t report = computeReportForRecentPeriodInSec(_wind_average_period_sec);
+    triggerAvgWindCb(report);
+    _next_report_millis = nextDeadline(_next_report_millis, _wind_update_period_sec * 1000UL, now);
+  }
 
-    // accumulate with an arbitrary magnitude, we are interested only in direction avg
-    VaneAverager.accumulate((uint32_t)1, angle);
+  // sleep until the next event instead of waking at a fixed rate
+  uint32_t wakeup_ms = nextWakeupMs();
+  if (wakeup_ms == 0)
+  {
+    wakeup_ms = 1;
   }
+  tickerTimer->setOverflow(wakeup_ms < MAX_WAKEUP_MS ? wakeup_ms : MAX_WAKEUP_MS, TICK_FORMAT);
+  tickerTimer->setCount(0);
+}
 
-  // reset the speed led for flash effect
-  digitalWrite(_speed_led_pin, LOW);
+// Store the samples of the windows elapsed since the previous one closed. Pulses are normalized by the
+// measured duration, so a window closed late still gives the right speed. When loop() was blocked for
+// several windows they are caught up together: each gets the mean speed and direction of the whole span.
+void WN_Core::closeSamplingWindow(uint32_t now)
+{
+  readPulseCounter();
+  uint32_t pulses = window_pulse_count;
+  window_pulse_count = 0;
+  uint32_t now_micros = micros();
 
-  if (ticks_cnt % SAMPLING_WINDOW_TICKS == 0)
-  { // counting window has elapsed
+  // windows that fit the elapsed time, the part of a window left over is carried to the next close
+  // so the number of samples keeps up with time
+  uint32_t elapsed_ms = now - _next_window_millis + SAMPLE_DURATION_MS;
+  int32_t span_ms = (int32_t)elapsed_ms + _window_carry_ms;
+  uint32_t windows = span_ms > (int32_t)(SAMPLE_DURATION_MS / 2) ? (span_ms + SAMPLE_DURATION_MS / 2) / SAMPLE_DURATION_MS : 1;
+  _window_carry_ms = span_ms - (int32_t)(windows * SAMPLE_DURATION_MS);
+  // micros() wraps after 71 minutes, millis() gives the duration of a longer block
+  float elapsed_us = (windows <= MAX_CATCH_UP_SAMPLES) ? (float)(now_micros - _window_start_micros) : (float)elapsed_ms * 1000;
+  _window_start_micros = now_micros;
+  _next_window_millis = now + SAMPLE_DURATION_MS;
 
-    // check timing, drop the sample if one or more ticks were missed (would be likely caused by a blocking delay in user program loop)
-    if (millis() - last_sampling_window_millis < SAMPLE_DURATION * 1000 + 1000 / TICK_HZ)
+  uint16_t stored = windows;
+  if (windows > MAX_CATCH_UP_SAMPLES)
+  {
+    _lost_samples += windows - MAX_CATCH_UP_SAMPLES;
+    stored = MAX_CATCH_UP_SAMPLES;
+  }
+
+  // pulses over the stored windows, the rounding error is carried to the next window so it averages out
+  float normalized = (elapsed_us > 0 ? pulses * (stored * (float)SAMPLE_DURATION_US) / elapsed_us : pulses) + _pulse_remainder;
+  uint32_t total = normalized > 0 ? (uint32_t)(normalized + 0.5f) : 0;
+  _pulse_remainder = normalized - total;
+
+  // we average the wind direction during that time and store the data points in a circular/rolling buffer
+  wn_raw_wind_report_t vane_raw_report;
+  VaneAverager.computeReportFromAccumulatedValues(&vane_raw_report);
+  wn_raw_wind_sample_t raw_sample = {0, vane_raw_report.dir_avg, true};
+  for (uint16_t i = 0; i < stored; i++)
+  {
+    uint32_t sample_pulses = total / stored + (i < total % stored ? 1 : 0);
+    raw_sample.pulses = sample_pulses < UINT16_MAX ? sample_pulses : UINT16_MAX;
+    RollingBuffer.addRawSample(raw_sample);
+#if WIND_ROSE
+    if (_wind_rose)
     {
-      // we average the wind direction during that time and store the data point in a circular/rolling buffer
-      wn_raw_wind_report_t vane_raw_report;
-      VaneAverager.computeReportFromAccumulatedValues(&vane_raw_report);
-      wn_raw_wind_sample_t raw_sample = {speed_pulse_count, vane_raw_report.dir_avg, true};
+      _wind_rose->add(pulsesToSpeedUnitInUse(raw_sample.pulses), raw_sample.dir, RollingBuffer.getTotalSamples() - 1);
+    }
+#endif
+    closeMinute();
+    triggerReportChannels();
+    evaluateEventTriggers();
+  }
 
-      // reset pulse counter as soon as sample is recorded
-      speed_pulse_count = 0;
-      last_sampling_window_millis = millis();
+  // trigger the instant wind callback set by user, once for the newest sample
+  wn_instant_wind_sample_t instant_wind_sample = formatRawSample(raw_sample);
+  formatWindowSpeeds(instant_wind_sample);
+  triggerInstantWindCb(instant_wind_sample);
+}
 
-      RollingBuffer.addRawSample(raw_sample);
+// Milliseconds until loop() has work to do: next vane measurement, sampling window or report.
+// While a vane conversion is in progress loop() should be called every millisecond.
+uint32_t WN_Core::nextWakeupMs()
+{
+  if (wn_is_angle_conversion_in_progress())
+  {
+    return 1;
+  }
 
-      wn_instant_wind_sample_t instant_wind_sample = formatRawSample(raw_sample);
-      // trigger the instant wind callback set by user
-      triggerInstantWindCb(instant_wind_sample);
-    }
-    else
+  uint32_t now = millis();
+  uint32_t next = _next_vane_millis;
+  if ((int32_t)(_next_window_millis - next) < 0)
+  {
+    next = _next_window_millis;
+  }
+  if ((int32_t)(_next_report_millis - next) < 0)
+  {
+    next = _next_report_millis;
+  }
+  return isDue(next, now) ? 0 : next - now;
+}
+
+// Add pulses counted since the previous read, by hardware or by the pulse interrupt, to the window in progress
+void WN_Core::readPulseCounter()
+{
+  uint32_t new_pulses;
+  if (_pulse_counting == PULSE_COUNTING_TIMER)
+  {
+    uint16_t counter_value = pulseCounterTimer->getCount(TICK_FORMAT);
+    new_pulses = (uint16_t)(counter_value - last_pulse_counter_value);
+    last_pulse_counter_value = counter_value;
+    _pulses_since_led_update += new_pulses;
+  }
+  else
+  {
+    uint32_t total = isr_pulse_total;
+    new_pulses = total - last_isr_pulse_total;
+    last_isr_pulse_total = total;
+  }
+  if (_pulse_counting == PULSE_COUNTING_CAPTURE)
+  {
+    readRotorPeriods();
+    _pulses_since_led_update += new_pulses;
+  }
+  window_pulse_count += new_pulses;
+}
+
+// Take the rotor periods queued by the capture interrupt into the window in progress
+void WN_Core::readRotorPeriods()
+{
+  uint32_t head = isr_period_head;
+  if (head - period_tail > CAPTURE_RING_LENGTH)
+  {
+    // loop() was late, the oldest periods were overwritten: they are missing from the mean and gust
+    period_tail = head - CAPTURE_RING_LENGTH;
+  }
+  for (; period_tail != head; period_tail++)
+  {
+    uint16_t period = isr_periods[period_tail % CAPTURE_RING_LENGTH];
+    if (period < _window_min_period)
     {
-      speed_pulse_count = 0;
-      last_sampling_window_millis = millis();
+      _window_min_period = period;
     }
+    _window_period_sum += period;
+    _window_periods++;
+  }
+}
+
+// With input capture, the speed of the sample is the mean of the rotor revolutions completed in the window,
+// finer than one pulse per window at low speed, and the gust is the fastest revolution. Stored samples keep
+// the pulse count. Without revolutions in the window (calm or other counting modes) both are the pulse count speed.
+void WN_Core::formatWindowSpeeds(wn_instant_wind_sample_t &sample)
+{
+  sample.gust = sample.speed;
+  if (_window_periods > 0)
+  {
+    float ticks_per_sample = (float)SAMPLE_DURATION * CAPTURE_TIMER_HZ;
+    sample.speed = pulsesToSpeedUnitInUse(ticks_per_sample * _window_periods / _window_period_sum);
+    sample.gust = pulsesToSpeedUnitInUse(ticks_per_sample / _window_min_period);
   }
+  _window_min_period = UINT16_MAX;
+  _window_period_sum = 0;
+  _window_periods = 0;
+}
 
-  if (ticks_cnt % (_wind_update_period_sec * TICK_HZ) == 0)
-  { // time interval between wind avg updates has elapsed
-    wn_wind_report_t report = computeReportForRecentPeriodInSec(_wind_average_period_sec);
-    triggerAvgWindCb(report);
+// Called at each vane measurement: the speed led stays ON until then when pulses were counted
+void WN_Core::updateSpeedLed()
+{
+  if (_pulse_counting != PULSE_COUNTING_INTERRUPT)
+  {
+    readPulseCounter();
+    digitalWrite(_speed_led_pin, (_pulses_since_led_update > 0 && !low_power_mode) ? HIGH : LOW);
+    _pulses_since_led_update = 0;
   }
+  else
+  {
+    // reset the speed led for flash effect
+    digitalWrite(_speed_led_pin, LOW);
+  }
+}
+
+// Highest 3 sec sample (WMO gust) over the averaging period, kept up to date at each sample without rescanning.
+float WN_Core::getCurrentGust()
+{
+  return pulsesToSpeedUnitInUse(RollingBuffer.getWindowMaxPulses());
+}
+
+// Lowest 3 sec sample over the averaging period, see getCurrentGust().
+float WN_Core::getCurrentLull()
+{
+  return pulsesToSpeedUnitInUse(RollingBuffer.getWindowMinPulses());
 }
 
+#if WIND_SPEED_PERCENTILES
+// Percentile (0 to 100) of the 3 sec samples over the averaging period, read from a histogram kept up to date at each sample.
+float WN_Core::getCurrentSpeedPercentile(float percent)
+{
+  return pulsesToSpeedUnitInUse(RollingBuffer.getWindowPulsesPercentile(percent));
+}
+
+wn_speed_percentiles_t WN_Core::getCurrentSpeedPercentiles()
+{
+  wn_speed_percentiles_t percentiles;
+  percentiles.median_speed = getCurrentSpeedPercentile(50);
+  percentiles.p90_speed = getCurrentSpeedPercentile(90);
+  percentiles.p99_speed = getCurrentSpeedPercentile(99);
+  return percentiles;
+}
+#endif
+
 // Compute wind report over the most recent interval (seconds).
 wn_wind_report_t WN_Core::computeReportForRecentPeriodInSec(uint16_t period)
 {
@@ -222,22 +760,34 @@ wn_instant_wind_sample_t WN_Core::getSampleIndexedFromLast(uint16_t index)
   return formatRawSample(raw_sample);
 }
 
-// Compute a wind report for a period (seconds), offset by an index (seconds) from the latest data.
-wn_wind_report_t WN_Core::computeReportForPeriodInSecIndexedFromLast(uint16_t period, uint16_t index)
+// Same as getSampleIndexedFromLast() but with the pulse count of the sample, normalized to 3 sec, see getSpeedPerPulse().
+wn_raw_wind_sample_t WN_Core::getRawSampleIndexedFromLast(uint16_t index)
 {
+  return RollingBuffer.get(index);
+}
+
+// Number of samples stored since start, an anchor for reading the same data again after new samples arrived.
+uint32_t WN_Core::getSampleCount()
+{
+  return RollingBuffer.getTotalSamples();
+}
 
-  uint16_t samples_to_average = period / (SAMPLING_WINDOW_TICKS / TICK_HZ); // how many samples should be read depends on the average period set
-  uint16_t shift = (index * period) / (SAMPLING_WINDOW_TICKS / TICK_HZ);
+// Sampling windows lost since start because loop() was blocked for more than a minute, shorter blocks are caught up.
+uint32_t WN_Core::getLostSampleCount()
+{
+  return _lost_samples;
+}
+
+// Compute a wind report for a period (seconds), offset by an index (periods) from the latest data,
+// plus an optional number of samples added since an anchor taken with getSampleCount().
+wn_wind_report_t WN_Core::computeReportForPeriodInSecIndexedFromLast(uint16_t period, uint16_t index, uint16_t sample_offset)
+{
+
+  uint16_t samples_to_average = period / SAMPLE_DURATION; // how many samples should be read depends on the average period set
+  uint32_t shift = ((uint32_t)index * period) / SAMPLE_DURATION + sample_offset;
   // read last samples from circular/rolling buffer and accumulate their cartesian coordinates
   WN_VECTOR_AVERAGER periodAverager;
-  for (uint16_t i = 0 + shift; i < samples_to_average + shift; i++)
-  {
-    wn_raw_wind_sample_t sample = RollingBuffer.get(i);
-    if (sample.valid)
-    {
-      periodAverager.accumulate(sample);
-    }
-  }
+  RollingBuffer.accumulateRange(periodAverager, shift, samples_to_average);
 
   // compute 2D averaging, min, max for period
   wn_raw_wind_report_t avg_raw_wind_report;
@@ -248,6 +798,170 @@ wn_wind_report_t WN_Core::computeReportForPeriodInSecIndexedFromLast(uint16_t pe
   return report;
 }
 
+#if WIND_EXTENDED_STATISTICS
+// Same as computeReportForRecentPeriodInSec() with the spread of the samples, see computeExtendedReportForPeriodInSecIndexedFromLast().
+wn_wind_extended_report_t WN_Core::computeExtendedReportForRecentPeriodInSec(uint16_t period)
+{
+  return computeExtendedReportForPeriodInSecIndexedFromLast(period, 0);
+}
+
+// Report with scalar mean speed, speed standard deviation and Yamartino direction standard deviation, all
+// accumulated in the same pass over the samples. Only samples still in the rolling buffer are used.
+wn_wind_extended_report_t WN_Core::computeExtendedReportForPeriodInSecIndexedFromLast(uint16_t period, uint16_t index)
+{
+  uint16_t samples_to_average = period / SAMPLE_DURATION;
+  uint32_t shift = ((uint32_t)index * period) / SAMPLE_DURATION;
+  WN_VECTOR_AVERAGER periodAverager;
+  RollingBuffer.accumulateRange(periodAverager, shift, samples_to_average, true);
+
+  wn_raw_wind_statistics_t statistics;
+  periodAverager.computeStatisticsFromAccumulatedValues(&statistics);
+  wn_raw_wind_report_t raw_report;
+  periodAverager.computeReportFromAccumulatedValues(&raw_report);
+
+  wn_wind_report_t vector_report = formatRawReport(raw_report);
+  wn_wind_extended_report_t report;
+  report.samples = statistics.cnt;
+  if (statistics.cnt == 0)
+  {
+    return report;
+  }
+  report.avg_speed = vector_report.avg_speed;
+  report.avg_dir = vector_report.avg_dir;
+  report.min_speed = vector_report.min_speed;
+  report.max_speed = vector_report.max_speed;
+  report.scalar_avg_speed = pulsesToSpeedUnitInUse(statistics.pulses_scalar_avg);
+  report.speed_std_dev = pulsesToSpeedUnitInUse(statistics.pulses_std_dev);
+  report.dir_std_dev = statistics.dir_std_dev;
+  return report;
+}
+#endif
+
+// log to flash every minute, to be called before begin()
+void WN_Core::enableWindLog()
+{
+  _wind_log_enabled = true;
+}
+
+#if WIND_ROSE
+// the wind rose counts every sample recorded from now on, in the speed unit in use
+void WN_Core::attachWindRose(WN_WIND_ROSE *wind_rose)
+{
+  _wind_rose = wind_rose;
+}
+#endif
+
+// when a minute closes, its report is computed once and cached, and the minute is logged
+void WN_Core::closeMinute()
+{
+  if (RollingBuffer.getClosedMinutes() == _closed_minutes)
+  {
+    return;
+  }
+  _closed_minutes = RollingBuffer.getClosedMinutes();
+
+  WN_VECTOR_AVERAGER minuteAverager;
+  RollingBuffer.accumulateRange(minuteAverager, 0, SAMPLES_PER_MINUTE);
+  wn_raw_wind_report_t raw_report;
+  minuteAverager.computeReportFromAccumulatedValues(&raw_report);
+  _minute_reports[_closed_minutes % MINUTE_REPORT_CACHE_LENGTH] = packMinuteReport(raw_report);
+
+  wn_raw_wind_history_t minute;
+  if (_wind_log_enabled && RollingBuffer.getClosedMinute(0, &minute))
+  {
+    WindLog.append(minute);
+  }
+}
+
+wn_minute_report_t WN_Core::packMinuteReport(wn_raw_wind_report_t &raw_report)
+{
+  wn_minute_report_t packed;
+  float pulses_avg_q6 = raw_report.pulses_avg * 64 + 0.5f;
+  packed.pulses_avg = pulses_avg_q6 < UINT16_MAX ? (uint16_t)pulses_avg_q6 : UINT16_MAX;
+  packed.dir_avg = raw_report.dir_avg;
+  packed.pulses_min = raw_report.pulses_min;
+  packed.pulses_max = raw_report.pulses_max;
+  return packed;
+}
+
+// minutes closed since start, a minute closes every SAMPLES_PER_MINUTE samples
+uint32_t WN_Core::getClosedMinuteCount()
+{
+  return _closed_minutes;
+}
+
+// report of a closed minute, index 0 is the last closed minute, false if that minute is not available
+// recent minutes are read from the cache, older ones from the minute history
+bool WN_Core::getMinuteReport(uint16_t index, wn_wind_report_t *report)
+{
+  if (index >= _closed_minutes)
+  {
+    return false;
+  }
+
+  // both ways give the same report, a minute leaving the cache doesn't change
+  wn_minute_report_t packed;
+  if (index < MINUTE_REPORT_CACHE_LENGTH)
+  {
+    packed = _minute_reports[(_closed_minutes - index) % MINUTE_REPORT_CACHE_LENGTH];
+  }
+  else
+  {
+    wn_raw_wind_history_t minute;
+    if (!RollingBuffer.getClosedMinute(index, &minute))
+    {
+      return false;
+    }
+    WN_VECTOR_AVERAGER minuteAverager;
+    minuteAverager.accumulate(minute);
+    wn_raw_wind_report_t history_report;
+    minuteAverager.computeReportFromAccumulatedValues(&history_report);
+    packed = packMinuteReport(history_report);
+  }
+
+  wn_raw_wind_report_t raw_report;
+  raw_report.pulses_avg = packed.pulses_avg / 64.0f;
+  raw_report.dir_avg = packed.dir_avg;
+  raw_report.pulses_min = packed.pulses_min;
+  raw_report.pulses_max = packed.pulses_max;
+  *report = formatRawReport(raw_report);
+  return true;
+}
+
+// sequence number of the oldest minute still in the log
+uint32_t WN_Core::getFirstLoggedMinute()
+{
+  return WindLog.getFirstSeq();
+}
+
+// sequence number the next logged minute will get, logged minutes are from getFirstLoggedMinute() to getEndLoggedMinute() - 1
+uint32_t WN_Core::getEndLoggedMinute()
+{
+  return WindLog.getEndSeq();
+}
+
+// report of a logged minute, false if that minute is missing from the log
+// after_reboot is set for the first minute logged after a reboot: time between it and the previous minute is unknown
+bool WN_Core::getLoggedMinuteReport(uint32_t seq, wn_wind_report_t *report, bool *after_reboot)
+{
+  wn_wind_log_record_t record;
+  if (!WindLog.read(seq, &record))
+  {
+    return false;
+  }
+
+  WN_VECTOR_AVERAGER minuteAverager;
+  minuteAverager.accumulate(record.minute);
+  wn_raw_wind_report_t raw_report;
+  minuteAverager.computeReportFromAccumulatedValues(&raw_report);
+  *report = formatRawReport(raw_report);
+  if (after_reboot)
+  {
+    *after_reboot = record.after_reboot;
+  }
+  return true;
+}
+
 // set the callback function that will be called when new instant wind update is available
 void WN_Core::onInstantWindUpdate(void (*cb)(wn_instant_wind_sample_t instant_report))
 {
@@ -281,6 +995,7 @@ wn_instant_wind_sample_t WN_Core::formatRawSample(wn_raw_wind_sample_t &raw_samp
   wn_instant_wind_sample_t sample;
 
   sample.speed = pulsesToSpeedUnitInUse(raw_sample.pulses);
+  sample.gust = sample.speed;
   sample.dir = raw_sample.dir;
   return sample;
 }
@@ -300,10 +1015,21 @@ void WN_Core::setSpeedUnit(wn_wind_unit_t unit)
   _unit_in_use = unit;
 }
 
+wn_wind_unit_t WN_Core::getSpeedUnit()
+{
+  return _unit_in_use;
+}
+
+// speed in the unit in use for one pulse counted during a sample
+float WN_Core::getSpeedPerPulse()
+{
+  return pulsesToSpeedUnitInUse(1);
+}
+
 float WN_Core::pulsesToSpeedUnitInUse(float pulses)
 {
 
-  float speed_ms = pulses * _HZ_to_ms / (SAMPLING_WINDOW_TICKS / TICK_HZ);
+  float speed_ms = pulses * _HZ_to_ms / SAMPLE_DURATION;
   switch (_unit_in_use)
   {
   case UNIT_MS:
@@ -334,6 +1060,18 @@ bool WN_Core::isLowPowerMode()
   return low_power_mode;
 }
 
+// false when pulses are counted by interrupts, either requested or because the speed input pin cannot clock a timer
+bool WN_Core::isPulseCountingByTimer()
+{
+  return _pulse_counting == PULSE_COUNTING_TIMER;
+}
+
+// pulse counting method in use after begin(), which falls back to PULSE_COUNTING_INTERRUPT when the input pin has no timer
+wn_pulse_counting_t WN_Core::getPulseCounting()
+{
+  return _pulse_counting;
+}
+
 uint8_t WN_Core::getI2cError()
 {
   return wn_get_last_angle_sensor_i2c_error();
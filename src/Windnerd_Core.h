@@ -10,6 +10,8 @@
 #include "Arduino.h"
 #include "Windnerd_Rolling_Buffer.h"
 #include "Windnerd_Vector_Averager.h"
+#include "Windnerd_Wind_Log.h"
+#include "Windnerd_Wind_Rose.h"
 
 // LED pins for WindNerd Core board
 #define CORE_SPEED_LED_PIN PA7
@@ -27,6 +29,7 @@ typedef struct
 {
   float speed = 0;
   uint16_t dir = 0;
+  float gust = 0; // fastest rotor revolution, in the instant wind callback with PULSE_COUNTING_CAPTURE, else same as speed
 } wn_instant_wind_sample_t;
 
 typedef struct
@@ -37,6 +40,94 @@ typedef struct
   float max_speed = 0;
 } wn_wind_report_t;
 
+#if WIND_EXTENDED_STATISTICS
+// wind report with the spread of the samples, computed from the raw samples still in the rolling buffer
+typedef struct
+{
+  float avg_speed = 0; // vector mean, as in wn_wind_report_t
+  uint16_t avg_dir = 0;
+  float min_speed = 0;
+  float max_speed = 0;
+  float scalar_avg_speed = 0; // mean of sample speeds, not reduced when direction changes
+  float speed_std_dev = 0;
+  float dir_std_dev = 0; // degrees
+  uint16_t samples = 0;
+} wn_wind_extended_report_t;
+#endif
+
+#if WIND_SPEED_PERCENTILES
+// percentiles of the sample speeds over the averaging period
+typedef struct
+{
+  float median_speed = 0;
+  float p90_speed = 0;
+  float p99_speed = 0;
+} wn_speed_percentiles_t;
+#endif
+
+// minutes whose report is kept once computed, older minutes are read from the minute history
+#ifndef MINUTE_REPORT_CACHE_LENGTH
+#define MINUTE_REPORT_CACHE_LENGTH 20
+#endif
+
+typedef enum
+{
+  WIND_EVENT_SPEED = 0,    // 1 minute mean speed rose past the threshold
+  WIND_EVENT_GUST_FACTOR,  // current gust over mean speed of the averaging period exceeded the ratio
+  WIND_EVENT_DIRECTION_SHIFT // mean direction of the last minute moved away from a recent minute
+} wn_wind_event_type_t;
+
+typedef struct
+{
+  wn_wind_event_type_t type;
+  float value; // speed, ratio or degrees that crossed the threshold
+} wn_wind_event_t;
+
+// a threshold crossed upwards fires once, then again only after the value went back below threshold - hysteresis
+// and min spacing has elapsed
+typedef struct
+{
+  bool enabled = false;
+  bool armed = true;
+  float threshold = 0;
+  float hysteresis = 0;
+  float min_speed = 0;   // gust factor and direction are ignored below this speed
+  uint8_t minutes = 0;   // direction shift: minutes to look back
+  uint32_t last_sample = 0; // sample count when it last fired
+} wn_event_trigger_t;
+
+#define WIND_EVENT_TRIGGER_COUNT 3
+#define DEFAULT_EVENT_MIN_SPACING_SAMPLES 100 // 5 minutes
+
+// report channels besides the main averaging period, 8 bytes of RAM each
+#ifndef REPORT_CHANNEL_COUNT
+#define REPORT_CHANNEL_COUNT 4
+#endif
+
+// a report of period_sec triggered every interval_samples samples
+typedef struct
+{
+  uint16_t period_sec = 0;
+  uint16_t interval_samples = 0;
+  void (*cb)(wn_wind_report_t report) = nullptr;
+} wn_report_channel_t;
+
+// report of a closed minute, finalized once when the minute closes
+typedef struct
+{
+  uint16_t pulses_avg = 0; // Q6
+  uint16_t dir_avg = 0;
+  uint16_t pulses_min = 0;
+  uint16_t pulses_max = 0;
+} wn_minute_report_t;
+
+typedef enum
+{
+  PULSE_COUNTING_TIMER = 0, // speed input clocks a hardware timer counter, read once per tick
+  PULSE_COUNTING_INTERRUPT, // one GPIO interrupt per rotor pulse, used as fallback when the input pin cannot clock a timer
+  PULSE_COUNTING_CAPTURE    // timer input capture timestamps each pulse, gives the speed of each rotor revolution
+} wn_pulse_counting_t;
+
 typedef enum
 {
   UNIT_MS = 0,
@@ -54,7 +145,8 @@ public:
       uint8_t north_led_pin = CORE_NORTH_LED_PIN,
       uint8_t speed_input_pin = CORE_SPEED_INPUT_PIN,
       uint8_t scl_pin = CORE_SCL_PIN,
-      uint8_t sda_pin = CORE_SDA_PIN
+      uint8_t sda_pin = CORE_SDA_PIN,
+      wn_pulse_counting_t pulse_counting = PULSE_COUNTING_TIMER
     );
   void loop(void);
   // set a callback function that will be triggered  every 3 sec for instant wind update
@@ -65,19 +157,61 @@ public:
   void onNewWindReport(void (*cb)(wn_wind_report_t report));
   void triggerAvgWindCb(wn_wind_report_t &report);
 
+  // set a callback function that will be triggered as soon as a wind event trigger fires
+  void onWindEvent(void (*cb)(wn_wind_event_t event));
+  void setSpeedTrigger(float threshold, float hysteresis);
+  void setGustFactorTrigger(float ratio, float hysteresis, float min_speed);
+  bool setDirectionShiftTrigger(uint16_t degrees, uint8_t minutes, uint16_t hysteresis, float min_speed);
+  void disableWindEvents();
+  void setEventMinSpacingSec(uint16_t spacing);
+
   void begin();
   bool setAveragingPeriodInSec(uint16_t period);
   bool setReportingIntervalInSec(uint16_t period);
+  // more reports with their own period and interval, e.g. 2 minutes for a display and 10 minutes for a database
+  bool setReportChannel(uint8_t channel, uint16_t period, uint16_t interval, void (*cb)(wn_wind_report_t report));
   void setFrequencyToWindSpeedRatio(float ratio);
   void setSpeedUnit(wn_wind_unit_t unit);
   void invertVanePolarity(bool should_invert);
+  void setAngleSensorIntPin(uint8_t int_pin);
   void enableLowPowerMode();
   void disableLowPowerMode();
   bool isLowPowerMode();
+  bool isPulseCountingByTimer();
+  wn_pulse_counting_t getPulseCounting();
   uint8_t getI2cError();
+  uint32_t nextWakeupMs();
+  float getCurrentGust();
+  float getCurrentLull();
+#if WIND_SPEED_PERCENTILES
+  float getCurrentSpeedPercentile(float percent);
+  wn_speed_percentiles_t getCurrentSpeedPercentiles();
+#endif
   wn_wind_report_t computeReportForRecentPeriodInSec(uint16_t period);
-  wn_wind_report_t computeReportForPeriodInSecIndexedFromLast(uint16_t period, uint16_t index);
+  wn_wind_report_t computeReportForPeriodInSecIndexedFromLast(uint16_t period, uint16_t index, uint16_t sample_offset = 0);
+#if WIND_EXTENDED_STATISTICS
+  wn_wind_extended_report_t computeExtendedReportForRecentPeriodInSec(uint16_t period);
+  wn_wind_extended_report_t computeExtendedReportForPeriodInSecIndexedFromLast(uint16_t period, uint16_t index);
+#endif
   wn_instant_wind_sample_t getSampleIndexedFromLast(uint16_t index);
+  wn_raw_wind_sample_t getRawSampleIndexedFromLast(uint16_t index);
+  uint32_t getSampleCount();
+  uint32_t getLostSampleCount();
+  uint32_t getClosedMinuteCount();
+  bool getMinuteReport(uint16_t index, wn_wind_report_t *report);
+  wn_wind_unit_t getSpeedUnit();
+  float getSpeedPerPulse();
+
+  // persistent log of closed minutes in flash, survives reboots
+  void enableWindLog();
+  uint32_t getFirstLoggedMinute();
+  uint32_t getEndLoggedMinute();
+  bool getLoggedMinuteReport(uint32_t seq, wn_wind_report_t *report, bool *after_reboot = NULL);
+
+#if WIND_ROSE
+  // wind rose updated at each new sample, NULL to detach
+  void attachWindRose(WN_WIND_ROSE *wind_rose);
+#endif
 
 private:
   float _HZ_to_ms;
@@ -87,24 +221,59 @@ private:
   uint8_t _speed_input_pin;
   uint8_t _scl_pin;
   uint8_t _sda_pin;
-
+  wn_pulse_counting_t _pulse_counting;
+  uint8_t _angle_sensor_int_pin;
 
   uint16_t _wind_average_period_sec;
   uint16_t _wind_update_period_sec;
-  uint32_t ticks_cnt = 0; // ticks counter to be used as time base for periodic functions
+  // millis() deadlines of the scheduled events
+  uint32_t _next_vane_millis = 0;
+  uint32_t _next_window_millis = 0;
+  uint32_t _next_report_millis = 0;
+  uint32_t _pulses_since_led_update = 0;
+  uint32_t _lost_samples = 0;
+  uint32_t _window_start_micros = 0;
+  int32_t _window_carry_ms = 0;
+  // rotor periods of the sampling window in progress, with PULSE_COUNTING_CAPTURE
+  uint16_t _window_min_period = UINT16_MAX;
+  uint32_t _window_period_sum = 0;
+  uint16_t _window_periods = 0;
+  float _pulse_remainder = 0;
   wn_wind_unit_t _unit_in_use = UNIT_MS;
   bool _invert_polarity = false;
 
-  long last_sampling_window_millis = 0;
-
   WN_ROLLINGBUFFER RollingBuffer;
   WN_VECTOR_AVERAGER VaneAverager;
+  WN_WIND_LOG WindLog;
+  bool _wind_log_enabled = false;
+#if WIND_ROSE
+  WN_WIND_ROSE *_wind_rose = NULL;
+#endif
+  uint32_t _closed_minutes = 0;
+  wn_minute_report_t _minute_reports[MINUTE_REPORT_CACHE_LENGTH];
+  wn_report_channel_t _report_channels[REPORT_CHANNEL_COUNT];
+  wn_event_trigger_t _event_triggers[WIND_EVENT_TRIGGER_COUNT];
+  uint16_t _event_min_spacing_samples = DEFAULT_EVENT_MIN_SPACING_SAMPLES;
+  uint32_t _minute_pulses_sum = 0; // sliding sum of the last SAMPLES_PER_MINUTE samples
 
   void (*instantWindCb)(wn_instant_wind_sample_t instant_report) = nullptr;
   void (*avgWindCb)(wn_wind_report_t report) = nullptr;
+  void (*windEventCb)(wn_wind_event_t event) = nullptr;
   wn_wind_report_t formatRawReport(wn_raw_wind_report_t &raw_report);
   wn_instant_wind_sample_t formatRawSample(wn_raw_wind_sample_t &raw_sample);
 
   float pulsesToSpeedUnitInUse(float pulses);
   void signalIfNorth(uint16_t angle);
+  void accumulateVaneAngle(uint16_t angle);
+  void closeSamplingWindow(uint32_t now);
+  void closeMinute();
+  void triggerReportChannels();
+  void evaluateEventTriggers();
+  void evaluateEventTrigger(wn_wind_event_type_t type, float value);
+  float directionShiftOfLastMinute(uint8_t minutes, uint16_t min_pulses_q6);
+  wn_minute_report_t packMinuteReport(wn_raw_wind_report_t &raw_report);
+  void readPulseCounter();
+  void readRotorPeriods();
+  void formatWindowSpeeds(wn_instant_wind_sample_t &sample);
+  void updateSpeedLed();
 };
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Windnerd_Crc.h"
+
+uint16_t wn_crc16_update(uint16_t crc, uint8_t byte)
+{
+  crc ^= (uint16_t)byte << 8;
+  for (uint8_t bit = 0; bit < 8; bit++)
+  {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+uint16_t wn_crc16(const uint8_t *data, size_t length)
+{
+  uint16_t crc = WN_CRC16_INIT;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc = wn_crc16_update(crc, data[i]);
+  }
+  return crc;
+}
@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include "Arduino.h"
+
+#define WN_CRC16_INIT 0xFFFF
+
+// CRC-16-CCITT (polynomial 0x1021, initial value 0xFFFF), bytewise or over a buffer
+uint16_t wn_crc16_update(uint16_t crc, uint8_t byte);
+uint16_t wn_crc16(const uint8_t *data, size_t length);
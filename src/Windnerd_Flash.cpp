@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Windnerd_Flash.h"
+
+#define LOG_FIRST_PAGE (FLASH_PAGE_NB - 1 - WIND_LOG_FLASH_PAGES)
+
+// end of the initialized data, the last section of the image in flash (STM32duino linker scripts)
+extern "C" uint32_t _sidata, _sdata, _edata;
+
+static volatile bool _log_read_in_progress = false;
+static volatile bool _log_read_ecc_error = false;
+
+static uint32_t pageAddress(uint8_t page)
+{
+  return FLASH_BASE + (uint32_t)(LOG_FIRST_PAGE + page) * FLASH_PAGE_SIZE;
+}
+
+// the page count depends on the flash size read at run time, so the image end is checked at run time too
+bool wn_flash_log_pages_free()
+{
+  uintptr_t image_end = (uintptr_t)&_sidata + ((uintptr_t)&_edata - (uintptr_t)&_sdata);
+  return FLASH_PAGE_NB > WIND_LOG_FLASH_PAGES + 1 && image_end <= pageAddress(0);
+}
+
+// erasing stalls the CPU for ~22 ms as code runs from the same flash bank
+bool wn_flash_erase_log_page(uint8_t page)
+{
+  FLASH_EraseInitTypeDef erase = {0};
+  erase.TypeErase = FLASH_TYPEERASE_PAGES;
+  erase.Banks = FLASH_BANK_1;
+  erase.Page = LOG_FIRST_PAGE + page;
+  erase.NbPages = 1;
+  uint32_t page_error = 0;
+
+  HAL_FLASH_Unlock();
+  HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &page_error);
+  HAL_FLASH_Lock();
+  return status == HAL_OK;
+}
+
+// a double word is the STM32G0 programming unit, it is written at once and protected by ECC.
+// It must be erased, except for 0 which can be programmed over anything, torn words included.
+bool wn_flash_program_log_doubleword(uint8_t page, uint16_t offset, uint64_t data)
+{
+  HAL_FLASH_Unlock();
+  HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, pageAddress(page) + offset, data);
+  HAL_FLASH_Lock();
+  return status == HAL_OK;
+}
+
+// false if the double word fails its ECC check, e.g. torn by a power loss while being programmed.
+// Reading it raises an NMI, which returns here through wn_flash_handle_ecc_nmi().
+bool wn_flash_read_log_doubleword(uint8_t page, uint16_t offset, uint64_t *data)
+{
+  _log_read_ecc_error = false;
+  _log_read_in_progress = true;
+  *data = *(const volatile uint64_t *)(uintptr_t)(pageAddress(page) + offset);
+  _log_read_in_progress = false;
+  return !_log_read_ecc_error;
+}
+
+bool wn_flash_handle_ecc_nmi()
+{
+  if (!_log_read_in_progress || !__HAL_FLASH_GET_FLAG(FLASH_FLAG_ECCD))
+  {
+    return false;
+  }
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ECCD);
+  _log_read_ecc_error = true;
+  return true;
+}
+
+#if WIND_LOG_NMI_HANDLER
+// replaces the default handler, which loops forever, for any other NMI as well
+extern "C" void NMI_Handler(void)
+{
+  if (!wn_flash_handle_ecc_nmi())
+  {
+    while (1)
+    {
+    }
+  }
+}
+#endif
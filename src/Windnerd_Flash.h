@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include "Arduino.h"
+
+// flash pages reserved for the wind log, just below the last flash page which is left
+// to the EEPROM emulation library (4 pages = 8 KB by default). The log stays disabled if the
+// sketch image reaches them, see wn_flash_log_pages_free().
+// Endurance: with 127 minutes per page, each page is erased every 127 * WIND_LOG_FLASH_PAGES minutes,
+// ~1040 times a year with 4 pages: the 10 000 cycles of the STM32G0 flash last ~10 years, ~20 years with 8 pages.
+#ifndef WIND_LOG_FLASH_PAGES
+#define WIND_LOG_FLASH_PAGES 4
+#endif
+
+// define the NMI handler recovering from ECC errors of log reads, off by default as it would replace
+// the handler of the sketch or core. A sketch logging minutes sets it or calls wn_flash_handle_ecc_nmi().
+#ifndef WIND_LOG_NMI_HANDLER
+#define WIND_LOG_NMI_HANDLER 0
+#endif
+
+#if WIND_LOG_FLASH_PAGES < 1 || WIND_LOG_FLASH_PAGES > 127
+#error "WIND_LOG_FLASH_PAGES must be 1 to 127"
+#endif
+
+#define WN_FLASH_PAGE_SIZE 2048
+#define WN_FLASH_ERASED_DOUBLEWORD 0xFFFFFFFFFFFFFFFFULL
+
+// page is 0 to WIND_LOG_FLASH_PAGES - 1, offset in bytes from page start, 8 bytes aligned
+bool wn_flash_log_pages_free();
+bool wn_flash_erase_log_page(uint8_t page);
+bool wn_flash_program_log_doubleword(uint8_t page, uint16_t offset, uint64_t data);
+bool wn_flash_read_log_doubleword(uint8_t page, uint16_t offset, uint64_t *data);
+
+// To be called by the NMI handler of the sketch when WIND_LOG_NMI_HANDLER is 0,
+// returns true if the NMI was an ECC error of a log read, which is then cleared.
+bool wn_flash_handle_ecc_nmi();
@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Windnerd_Modem.h"
+
+WN_MODEM::WN_MODEM(Stream *serial, Print *debug)
+    : _serial(serial),
+      _debug(debug)
+{
+}
+
+// set the APN before posting if the network requires it
+void WN_MODEM::setApn(const char *apn)
+{
+  _apn = apn;
+}
+
+void WN_MODEM::setUrl(const char *url)
+{
+  _url = url;
+}
+
+// attempts after the first one for each command, on ERROR or timeout
+void WN_MODEM::setRetries(uint8_t retries)
+{
+  _retries = retries;
+}
+
+// the whole exchange fails if it takes longer, so the modem is not kept awake when the network is down
+void WN_MODEM::setAwakeBudgetMs(uint32_t budget_ms)
+{
+  _awake_budget_ms = budget_ms;
+}
+
+// start posting a payload, false if an exchange is already in progress
+// the payload is acknowledged when the server answers with a 2xx status
+bool WN_MODEM::post(WN_WTP_PAYLOAD *payload)
+{
+  if (isBusy())
+  {
+    return false;
+  }
+  _payload = payload;
+  start(STEP_AT);
+  return true;
+}
+
+// start a single command expecting OK (e.g. AT+CSCLK=2 before sleeping), false if busy
+bool WN_MODEM::command(const char *cmd)
+{
+  if (isBusy())
+  {
+    return false;
+  }
+  _command = cmd;
+  start(STEP_COMMAND);
+  return true;
+}
+
+wn_modem_status_t WN_MODEM::getStatus()
+{
+  return _status;
+}
+
+bool WN_MODEM::isBusy()
+{
+  return _status == MODEM_BUSY;
+}
+
+// HTTP status of the last post, 0 if the modem did not get any
+int WN_MODEM::getHttpStatus()
+{
+  return _http_status;
+}
+
+// duration of the last exchange
+uint32_t WN_MODEM::getAwakeMs()
+{
+  return _awake_ms;
+}
+
+void WN_MODEM::start(wn_modem_step_t step)
+{
+  // drop anything left from the previous exchange
+  while (_serial->available())
+  {
+    _serial->read();
+  }
+  _line_length = 0;
+  _attempts = 0;
+  _http_status = 0;
+  _status = MODEM_BUSY;
+  _start_millis = millis();
+  enterStep(step);
+}
+
+void WN_MODEM::enterStep(wn_modem_step_t step)
+{
+  if (step == STEP_APN && _apn == NULL)
+  {
+    step = STEP_TERMINATE;
+  }
+
+  _step = step;
+  _step_millis = millis();
+  _step_timeout_ms = MODEM_COMMAND_TIMEOUT_MS;
+
+  switch (step)
+  {
+  case STEP_AT:
+    _step_timeout_ms = MODEM_AT_TIMEOUT_MS;
+    _serial->println("AT");
+    break;
+  case STEP_APN:
+    _serial->print("AT+CGDCONT=1,\"IP\",\"");
+    _serial->print(_apn);
+    _serial->println("\"");
+    break;
+  case STEP_TERMINATE:
+    _serial->println("AT+HTTPTERM");
+    break;
+  case STEP_INIT:
+    _serial->println("AT+HTTPINIT");
+    break;
+  case STEP_URL:
+    _serial->print("AT+HTTPPARA=\"URL\",\"");
+    _serial->print(_url);
+    _serial->println("\"");
+    break;
+  case STEP_CONTENT:
+    _serial->print("AT+HTTPPARA=\"CONTENT\",\"");
+    _serial->print(_payload->getContentType());
+    _serial->println("\"");
+    break;
+  case STEP_DATA:
+    _serial->print("AT+HTTPDATA=");
+    _serial->print(_payload->calculatePayloadLength());
+    _serial->println(",10000");
+    break;
+  case STEP_PAYLOAD:
+    // sent on the DOWNLOAD prompt, the length given to AT+HTTPDATA is exact. The only blocking step: the payload
+    // is composed as it is sent, this call waits for the UART once the TX buffer is full (~1 ms per 11.5 bytes at 115200 bauds)
+    _payload->sendPayload(_serial, _debug);
+    break;
+  case STEP_ACTION:
+    _serial->println("AT+HTTPACTION=1");
+    break;
+  case STEP_RESULT:
+    _step_timeout_ms = MODEM_ACTION_TIMEOUT_MS;
+    break;
+  case STEP_CLOSE:
+    _serial->println("AT+HTTPTERM");
+    break;
+  case STEP_COMMAND:
+    _serial->println(_command);
+    break;
+  }
+}
+
+void WN_MODEM::nextStep()
+{
+  _attempts = 0;
+  switch (_step)
+  {
+  case STEP_CLOSE:
+    finish(_http_status >= 200 && _http_status < 300 ? MODEM_DONE : MODEM_FAILED);
+    return;
+  case STEP_COMMAND:
+    finish(MODEM_DONE);
+    return;
+  case STEP_AT:
+    enterStep(STEP_APN);
+    return;
+  default:
+    enterStep((wn_modem_step_t)(_step + 1));
+    return;
+  }
+}
+
+void WN_MODEM::retryStep()
+{
+  // the payload can't be sent again without a new AT+HTTPDATA, and a post must not be repeated
+  if (_step == STEP_PAYLOAD || _step == STEP_ACTION || _step == STEP_RESULT)
+  {
+    enterStep(STEP_CLOSE);
+    return;
+  }
+  if (_attempts >= _retries)
+  {
+    finish(MODEM_FAILED);
+    return;
+  }
+  _attempts++;
+  enterStep(_step);
+}
+
+void WN_MODEM::finish(wn_modem_status_t status)
+{
+  if (status == MODEM_DONE && _payload && _step == STEP_CLOSE)
+  {
+    _payload->acknowledge();
+  }
+  _awake_ms = millis() - _start_millis;
+  _status = status;
+  _payload = NULL;
+  if (_debug)
+  {
+    _debug->print(status == MODEM_DONE ? "Modem done in " : "Modem failed after ");
+    _debug->print(_awake_ms);
+    _debug->println(" ms");
+  }
+}
+
+// a complete line was received from the modem, command echoes and unrelated URCs are ignored
+void WN_MODEM::handleLine()
+{
+  if (_debug)
+  {
+    _debug->print("Modem: ");
+    _debug->println(_line);
+  }
+
+  if (strncmp(_line, "+HTTPACTION:", 12) == 0)
+  {
+    // +HTTPACTION: <method>,<status>,<length>
+    const char *status = strchr(_line, ',');
+    _http_status = status ? atoi(status + 1) : 0;
+    if (_step == STEP_ACTION || _step == STEP_RESULT)
+    {
+      enterStep(STEP_CLOSE);
+    }
+    return;
+  }
+
+  if (strcmp(_line, "DOWNLOAD") == 0)
+  {
+    if (_step == STEP_DATA)
+    {
+      enterStep(STEP_PAYLOAD);
+    }
+    return;
+  }
+
+  if (strcmp(_line, "OK") == 0)
+  {
+    // the OK of AT+HTTPDATA comes after the payload
+    if (_step != STEP_DATA && _step != STEP_RESULT)
+    {
+      nextStep();
+    }
+    return;
+  }
+
+  if (strcmp(_line, "ERROR") == 0 || strncmp(_line, "+CME ERROR", 10) == 0)
+  {
+    // no HTTP session to terminate is not an error, nor when closing
+    if (_step == STEP_TERMINATE || _step == STEP_CLOSE)
+    {
+      nextStep();
+      return;
+    }
+    retryStep();
+  }
+}
+
+void WN_MODEM::loop()
+{
+  while (_serial->available())
+  {
+    char c = _serial->read();
+    if (c == '\r')
+    {
+      continue;
+    }
+    if (c != '\n')
+    {
+      if (_line_length < MODEM_LINE_LENGTH - 1)
+      {
+        _line[_line_length++] = c;
+      }
+      continue;
+    }
+    _line[_line_length] = '\0';
+    bool empty = _line_length == 0;
+    _line_length = 0;
+    if (!empty && isBusy())
+    {
+      handleLine();
+    }
+  }
+
+  if (!isBusy())
+  {
+    return;
+  }
+
+  uint32_t now = millis();
+  if (now - _start_millis > _awake_budget_ms)
+  {
+    finish(MODEM_FAILED);
+    return;
+  }
+  if (now - _step_millis > _step_timeout_ms)
+  {
+    retryStep();
+  }
+}
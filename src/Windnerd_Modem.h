@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include "Arduino.h"
+#include "Windnerd_Wtp_Payload.h"
+
+#define MODEM_LINE_LENGTH 64
+#define MODEM_AT_TIMEOUT_MS 1000        // the first AT can be lost while the modem wakes up, it is retried sooner
+#define MODEM_COMMAND_TIMEOUT_MS 5000   // HTTPINIT can take seconds on some firmware versions
+#define MODEM_ACTION_TIMEOUT_MS 30000   // from AT+HTTPACTION to the +HTTPACTION result
+#define MODEM_DEFAULT_RETRIES 2         // per command, on ERROR or timeout
+#define MODEM_DEFAULT_AWAKE_BUDGET_MS 60000
+#define MODEM_DEFAULT_URL "http://wtp.windnerd.net/post"
+
+typedef enum
+{
+  MODEM_IDLE = 0,
+  MODEM_BUSY,
+  MODEM_DONE,  // last exchange completed, see getHttpStatus() for a post
+  MODEM_FAILED // ERROR after retries, timeout or awake budget exceeded
+} wn_modem_status_t;
+
+// Non-blocking driver for SIMCom-like LTE modems (A7670X...) posting WTP payloads over HTTP.
+// Responses are read from the serial RX buffer (filled by the UART interrupt) and parsed by loop(),
+// each command is followed by the next one as soon as the modem answers. Only the payload is sent in one loop() call,
+// which lasts as long as the UART takes to send it, see docs/API-REFERENCE.md.
+class WN_MODEM
+{
+
+public:
+  WN_MODEM(Stream *serial, Print *debug = NULL);
+
+  void setApn(const char *apn);
+  void setUrl(const char *url);
+  void setRetries(uint8_t retries);
+  void setAwakeBudgetMs(uint32_t budget_ms);
+
+  bool post(WN_WTP_PAYLOAD *payload);
+  bool command(const char *cmd);
+  void loop();
+
+  wn_modem_status_t getStatus();
+  bool isBusy();
+  int getHttpStatus();
+  uint32_t getAwakeMs();
+
+private:
+  typedef enum
+  {
+    STEP_AT = 0,
+    STEP_APN,
+    STEP_TERMINATE,
+    STEP_INIT,
+    STEP_URL,
+    STEP_CONTENT,
+    STEP_DATA,
+    STEP_PAYLOAD,
+    STEP_ACTION,
+    STEP_RESULT,
+    STEP_CLOSE,
+    STEP_COMMAND
+  } wn_modem_step_t;
+
+  void start(wn_modem_step_t step);
+  void enterStep(wn_modem_step_t step);
+  void nextStep();
+  void retryStep();
+  void finish(wn_modem_status_t status);
+  void handleLine();
+
+  Stream *_serial;
+  Print *_debug;
+  const char *_apn = NULL;
+  const char *_url = MODEM_DEFAULT_URL;
+  const char *_command = NULL;
+  WN_WTP_PAYLOAD *_payload = NULL;
+  uint8_t _retries = MODEM_DEFAULT_RETRIES;
+  uint32_t _awake_budget_ms = MODEM_DEFAULT_AWAKE_BUDGET_MS;
+
+  wn_modem_status_t _status = MODEM_IDLE;
+  wn_modem_step_t _step = STEP_AT;
+  uint8_t _attempts = 0;
+  uint32_t _start_millis = 0;
+  uint32_t _step_millis = 0;
+  uint32_t _step_timeout_ms = 0;
+  uint32_t _awake_ms = 0;
+  int _http_status = 0;
+
+  char _line[MODEM_LINE_LENGTH];
+  uint8_t _line_length = 0;
+};
@@ -7,19 +7,326 @@
  */
 
 #include "Windnerd_Rolling_Buffer.h"
+#include "Windnerd_Vector_Averager.h"
+
+// Q15 sums are stored as Q6 means in history records
+#define HISTORY_SHIFT 9
+
+static wn_packed_wind_sample_t pack(const wn_raw_wind_sample_t &sample)
+{
+  uint32_t pulses = sample.pulses < PACKED_SAMPLE_MAX_PULSES ? sample.pulses : PACKED_SAMPLE_MAX_PULSES;
+  uint32_t bits = ((uint32_t)(sample.dir & 0x1FF) << 15) | pulses;
+  return {{(uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits}};
+}
+
+static wn_raw_wind_sample_t unpack(const wn_packed_wind_sample_t &packed)
+{
+  uint32_t bits = ((uint32_t)packed.bytes[0] << 16) | ((uint16_t)packed.bytes[1] << 8) | packed.bytes[2];
+  return {(uint16_t)(bits & PACKED_SAMPLE_MAX_PULSES), (uint16_t)(bits >> 15), true};
+}
+
+static int16_t toHistoryMean(int32_t sum, uint16_t cnt, uint8_t shift)
+{
+  int32_t mean = ((sum / (int32_t)cnt) + (1L << (shift - 1))) >> shift;
+  if (mean > INT16_MAX)
+    return INT16_MAX;
+  if (mean < INT16_MIN)
+    return INT16_MIN;
+  return mean;
+}
+
+// merge the last closed records of a tier into one record of the next tier
+// last is the position of the newest record in its ring
+static wn_raw_wind_history_t foldHistory(const wn_raw_wind_history_t *ring, size_t ring_length, size_t last, size_t records)
+{
+  int32_t x = 0;
+  int32_t y = 0;
+  wn_raw_wind_history_t folded;
+  for (size_t i = 0; i < records; i++)
+  {
+    const wn_raw_wind_history_t &record = ring[(last + ring_length - i) % ring_length];
+    x += (int32_t)record.x * record.cnt;
+    y += (int32_t)record.y * record.cnt;
+    folded.cnt += record.cnt;
+    if (record.pulses_max > folded.pulses_max)
+      folded.pulses_max = record.pulses_max;
+    if (record.pulses_min < folded.pulses_min)
+      folded.pulses_min = record.pulses_min;
+  }
+  if (folded.cnt > 0)
+  {
+    folded.x = toHistoryMean(x << 1, folded.cnt, 1);
+    folded.y = toHistoryMean(y << 1, folded.cnt, 1);
+  }
+  return folded;
+}
+
+// append a sample to a sliding extreme, dropping the candidates it outranks
+static void pushExtreme(wn_sliding_extreme_t &extreme, uint16_t seq, uint16_t pulses, bool is_max)
+{
+  if (extreme.incomplete && (is_max ? pulses >= extreme.left_out : pulses <= extreme.left_out))
+  {
+    // newer and as high (low): the candidates left out will never be the extreme
+    extreme.incomplete = false;
+  }
+  while (extreme.length > 0)
+  {
+    uint8_t last = (extreme.first + extreme.length - 1) % EXTREMES_DEQUE_LENGTH;
+    if (is_max ? extreme.pulses[last] > pulses : extreme.pulses[last] < pulses)
+    {
+      break;
+    }
+    extreme.length--;
+  }
+  if (extreme.length == EXTREMES_DEQUE_LENGTH)
+  {
+    // smaller (or larger) than every candidate: only needed once they all left the window,
+    // an earlier one left out is still higher (lower) when incomplete is already set
+    if (!extreme.incomplete)
+    {
+      extreme.incomplete = true;
+      extreme.left_out = pulses;
+    }
+    return;
+  }
+  uint8_t pos = (extreme.first + extreme.length) % EXTREMES_DEQUE_LENGTH;
+  extreme.seq[pos] = seq;
+  extreme.pulses[pos] = pulses;
+  extreme.length++;
+}
+
+// drop candidates older than the window, false when a candidate left out outranks the ones kept:
+// the deque must then be refilled from the window
+static bool expireExtreme(wn_sliding_extreme_t &extreme, uint16_t newest_seq, size_t window, bool is_max)
+{
+  while (extreme.length > 0 && (uint16_t)(newest_seq - extreme.seq[extreme.first]) >= window)
+  {
+    extreme.first = (extreme.first + 1) % EXTREMES_DEQUE_LENGTH;
+    extreme.length--;
+  }
+  if (!extreme.incomplete)
+  {
+    return true;
+  }
+  return extreme.length > 0 && (is_max ? extreme.pulses[extreme.first] >= extreme.left_out : extreme.pulses[extreme.first] <= extreme.left_out);
+}
+
+#if WIND_SPEED_PERCENTILES
+// histogram bucket of a sample, 8 buckets per octave above the linear ones
+static uint8_t histogramBucket(uint16_t pulses)
+{
+  if (pulses < HISTOGRAM_LINEAR_BUCKETS)
+  {
+    return pulses;
+  }
+  uint8_t shift = 0;
+  while ((pulses >> shift) >= 2 * HISTOGRAM_BUCKETS_PER_OCTAVE)
+  {
+    shift++;
+  }
+  return HISTOGRAM_LINEAR_BUCKETS + (shift - HISTOGRAM_FIRST_SHIFT) * HISTOGRAM_BUCKETS_PER_OCTAVE + (pulses >> shift) - HISTOGRAM_BUCKETS_PER_OCTAVE;
+}
+
+// lowest pulse count of a bucket, the bucket holds (1 << shift) counts
+static uint16_t histogramBucketStart(uint8_t bucket, uint8_t *shift)
+{
+  if (bucket < HISTOGRAM_LINEAR_BUCKETS)
+  {
+    *shift = 0;
+    return bucket;
+  }
+  uint8_t octave = (bucket - HISTOGRAM_LINEAR_BUCKETS) / HISTOGRAM_BUCKETS_PER_OCTAVE;
+  uint8_t step = (bucket - HISTOGRAM_LINEAR_BUCKETS) % HISTOGRAM_BUCKETS_PER_OCTAVE;
+  *shift = octave + HISTOGRAM_FIRST_SHIFT;
+  return (HISTOGRAM_BUCKETS_PER_OCTAVE + step) << *shift;
+}
+#endif
 
 WN_ROLLINGBUFFER::WN_ROLLINGBUFFER()
 {
+#if WIND_SPEED_PERCENTILES
+  memset(window_histogram, 0, sizeof(window_histogram));
+#endif
 }
 
 void WN_ROLLINGBUFFER::addRawSample(wn_raw_wind_sample_t& raw_sample)
 {
+  if (!raw_sample.valid)
+  {
+    return;
+  }
+
+  // the oldest sample of the window leaves it, read before it can be overwritten
+  if (extremes_window > 0 && count >= extremes_window)
+  {
+    uint16_t leaving = get(extremes_window - 1).pulses;
+#if WIND_SPEED_PERCENTILES
+    window_histogram[histogramBucket(leaving)]--;
+#endif
+    window_pulses_sum -= leaving;
+  }
+
   head = (head + 1) % ROLLING_BUFFER_LENGTH;
-  samples[head] = raw_sample;
+  samples[head] = pack(raw_sample);
   if (count < ROLLING_BUFFER_LENGTH)
   {
     count++;
   }
+  total++;
+
+  wn_raw_wind_sample_t stored_sample = unpack(samples[head]);
+  wn_aggregate_sample(current_minute, stored_sample);
+  updateExtremes(stored_sample.pulses);
+
+  // cascade closed periods: minute -> 10 minutes -> hour
+  if (total % SAMPLES_PER_MINUTE == 0)
+  {
+    size_t minute_pos = (total / SAMPLES_PER_MINUTE - 1) % MINUTE_HISTORY_LENGTH;
+    wn_raw_wind_history_t &minute = minutes[minute_pos];
+    minute.x = toHistoryMean(current_minute.x, current_minute.cnt, HISTORY_SHIFT);
+    minute.y = toHistoryMean(current_minute.y, current_minute.cnt, HISTORY_SHIFT);
+    minute.cnt = current_minute.cnt;
+    minute.pulses_min = current_minute.pulses_min;
+    minute.pulses_max = current_minute.pulses_max;
+    current_minute = {};
+
+    if (total % SAMPLES_PER_TEN_MINUTES == 0)
+    {
+      size_t ten_minute_pos = (total / SAMPLES_PER_TEN_MINUTES - 1) % TEN_MINUTE_HISTORY_LENGTH;
+      ten_minutes[ten_minute_pos] = foldHistory(minutes, MINUTE_HISTORY_LENGTH, minute_pos, 10);
+
+      if (total % SAMPLES_PER_HOUR == 0)
+      {
+        size_t hour_pos = (total / SAMPLES_PER_HOUR - 1) % HOUR_HISTORY_LENGTH;
+        hours[hour_pos] = foldHistory(ten_minutes, TEN_MINUTE_HISTORY_LENGTH, ten_minute_pos, 6);
+      }
+    }
+  }
+}
+
+// the sliding maximum, minimum and histogram follow each sample in constant time (amortized)
+void WN_ROLLINGBUFFER::updateExtremes(uint16_t pulses)
+{
+  if (extremes_window == 0)
+  {
+    return;
+  }
+#if WIND_SPEED_PERCENTILES
+  window_histogram[histogramBucket(pulses)]++;
+#endif
+  window_pulses_sum += pulses;
+  uint16_t seq = total - 1;
+  pushExtreme(window_max, seq, pulses, true);
+  pushExtreme(window_min, seq, pulses, false);
+  bool max_complete = expireExtreme(window_max, seq, extremes_window, true);
+  bool min_complete = expireExtreme(window_min, seq, extremes_window, false);
+  if (!max_complete || !min_complete)
+  {
+    rebuildExtremes();
+  }
+}
+
+// refill both deques from the samples of the window
+void WN_ROLLINGBUFFER::rebuildExtremes()
+{
+  window_max = {};
+  window_min = {};
+  size_t length = extremes_window < count ? extremes_window : count;
+  for (size_t i = length; i-- > 0;)
+  {
+    uint16_t pulses = get(i).pulses;
+    pushExtreme(window_max, total - 1 - i, pulses, true);
+    pushExtreme(window_min, total - 1 - i, pulses, false);
+  }
+}
+
+// number of most recent samples covered by getWindowMaxPulses(), getWindowMinPulses(), getWindowMeanPulses()
+// and getWindowPulsesPercentile(), 0 to disable
+void WN_ROLLINGBUFFER::setExtremesWindow(size_t length)
+{
+  extremes_window = length < ROLLING_BUFFER_LENGTH ? length : ROLLING_BUFFER_LENGTH;
+#if WIND_SPEED_PERCENTILES
+  memset(window_histogram, 0, sizeof(window_histogram));
+#endif
+  window_pulses_sum = 0;
+  size_t window_length = extremes_window < count ? extremes_window : count;
+  for (size_t i = 0; i < window_length; i++)
+  {
+    uint16_t pulses = get(i).pulses;
+#if WIND_SPEED_PERCENTILES
+    window_histogram[histogramBucket(pulses)]++;
+#endif
+    window_pulses_sum += pulses;
+  }
+  rebuildExtremes();
+}
+
+// highest sample of the window, 0 without samples
+uint16_t WN_ROLLINGBUFFER::getWindowMaxPulses()
+{
+  return window_max.length > 0 ? window_max.pulses[window_max.first] : 0;
+}
+
+// lowest sample of the window, 0 without samples
+uint16_t WN_ROLLINGBUFFER::getWindowMinPulses()
+{
+  return window_min.length > 0 ? window_min.pulses[window_min.first] : 0;
+}
+
+#if WIND_SPEED_PERCENTILES
+// sample of a given rank in the window, from 0 for the lowest one: exact in the linear buckets,
+// spread evenly over the bucket above
+float WN_ROLLINGBUFFER::windowOrderStatistic(uint16_t rank)
+{
+  uint16_t below = 0;
+  for (uint8_t bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+  {
+    uint16_t in_bucket = window_histogram[bucket];
+    if (rank < below + in_bucket)
+    {
+      uint8_t shift;
+      uint16_t start = histogramBucketStart(bucket, &shift);
+      if (shift == 0)
+      {
+        return start;
+      }
+      return start + (float)(1 << shift) * (rank - below + 0.5f) / in_bucket;
+    }
+    below += in_bucket;
+  }
+  return 0;
+}
+
+// percentile (0 to 100) of the samples of the window, interpolated between the samples around it
+// as most statistics packages do, 0 without samples
+float WN_ROLLINGBUFFER::getWindowPulsesPercentile(float percent)
+{
+  size_t length = extremes_window < count ? extremes_window : count;
+  if (length == 0)
+  {
+    return 0;
+  }
+  float position = percent / 100 * (length - 1);
+  if (position <= 0)
+  {
+    return windowOrderStatistic(0);
+  }
+  uint16_t rank = (uint16_t)position;
+  if (rank >= length - 1)
+  {
+    return windowOrderStatistic(length - 1);
+  }
+  float low = windowOrderStatistic(rank);
+  float high = windowOrderStatistic(rank + 1);
+  return low + (high - low) * (position - rank);
+}
+#endif
+
+// mean of the samples of the window, 0 without samples
+float WN_ROLLINGBUFFER::getWindowMeanPulses()
+{
+  size_t length = extremes_window < count ? extremes_window : count;
+  return length > 0 ? (float)window_pulses_sum / length : 0;
 }
 
 // get a sample reversely indexed from last inserted position
@@ -30,5 +337,102 @@ wn_raw_wind_sample_t WN_ROLLINGBUFFER::get(size_t index)
     return {0, 0, false};
   }
   size_t pos = (head + ROLLING_BUFFER_LENGTH - index) % ROLLING_BUFFER_LENGTH;
-  return samples[pos];
+  return unpack(samples[pos]);
+}
+
+// number of minutes closed since start
+// samples added since start, used to anchor indexes from last across calls
+uint32_t WN_ROLLINGBUFFER::getTotalSamples()
+{
+  return total;
+}
+
+uint32_t WN_ROLLINGBUFFER::getClosedMinutes()
+{
+  return total / SAMPLES_PER_MINUTE;
+}
+
+// get a closed minute reversely indexed from the last one, false if it is not in history anymore
+bool WN_ROLLINGBUFFER::getClosedMinute(size_t index, wn_raw_wind_history_t *record)
+{
+  uint32_t closed = getClosedMinutes();
+  if (index >= closed || index >= MINUTE_HISTORY_LENGTH)
+  {
+    return false;
+  }
+  *record = minutes[(closed - 1 - index) % MINUTE_HISTORY_LENGTH];
+  return true;
+}
+
+// Find the longest closed period starting at sample index (reversely indexed) and ending before end.
+// Returns nullptr if no history record matches, span is set to the samples covered by the record.
+const wn_raw_wind_history_t *WN_ROLLINGBUFFER::findHistory(size_t index, size_t end, size_t *span)
+{
+  static const uint16_t periods[] = {SAMPLES_PER_HOUR, SAMPLES_PER_TEN_MINUTES, SAMPLES_PER_MINUTE};
+  static const size_t ring_lengths[] = {HOUR_HISTORY_LENGTH, TEN_MINUTE_HISTORY_LENGTH, MINUTE_HISTORY_LENGTH};
+  wn_raw_wind_history_t *rings[] = {hours, ten_minutes, minutes};
+
+  for (uint8_t tier = 0; tier < 3; tier++)
+  {
+    uint16_t period = periods[tier];
+    size_t in_progress = total % period; // newest samples, not closed into a record yet
+    if (index < in_progress || (index - in_progress) % period != 0 || index + period > end)
+    {
+      continue;
+    }
+    size_t records_back = (index - in_progress) / period;
+    if (records_back >= ring_lengths[tier] || records_back >= total / period)
+    {
+      continue;
+    }
+    *span = period;
+    size_t pos = (total / period - 1 - records_back) % ring_lengths[tier];
+    return &rings[tier][pos];
+  }
+  return nullptr;
+}
+
+// accumulate samples reversely indexed from index to index + length - 1,
+// closed minutes, 10 minutes and hours are taken from history records so that only the edges
+// of the range are read sample by sample. Beyond raw samples, only whole records are accumulated.
+// raw_samples_only reads every sample still in the buffer and nothing else, for statistics of the averager.
+void WN_ROLLINGBUFFER::accumulateRange(WN_VECTOR_AVERAGER &averager, size_t index, size_t length, bool raw_samples_only)
+{
+  size_t end = index + length;
+
+  // minute in progress
+  size_t in_progress = total % SAMPLES_PER_MINUTE;
+  if (index == 0 && in_progress > 0 && in_progress <= end && !raw_samples_only)
+  {
+    averager.accumulate(current_minute);
+    index = in_progress;
+  }
+
+  size_t pos = (head + ROLLING_BUFFER_LENGTH - index % ROLLING_BUFFER_LENGTH) % ROLLING_BUFFER_LENGTH;
+
+  while (index < end)
+  {
+    size_t span;
+    const wn_raw_wind_history_t *record = raw_samples_only ? nullptr : findHistory(index, end, &span);
+    if (record)
+    {
+      averager.accumulate(*record);
+      index += span;
+      pos = (pos + ROLLING_BUFFER_LENGTH - span % ROLLING_BUFFER_LENGTH) % ROLLING_BUFFER_LENGTH;
+      continue;
+    }
+
+    if (index < count)
+    {
+      averager.accumulate(unpack(samples[pos]));
+      index++;
+      pos = (pos == 0) ? ROLLING_BUFFER_LENGTH - 1 : pos - 1;
+      continue;
+    }
+
+    // neither raw samples nor history: skip to the next minute boundary
+    size_t to_boundary = SAMPLES_PER_MINUTE - (index - in_progress) % SAMPLES_PER_MINUTE;
+    index += to_boundary;
+    pos = (pos + ROLLING_BUFFER_LENGTH - to_boundary % ROLLING_BUFFER_LENGTH) % ROLLING_BUFFER_LENGTH;
+  }
 }
@@ -9,15 +9,104 @@
 #pragma once
 #include "Arduino.h"
 
-#define ROLLING_BUFFER_LENGTH 400 // 20 minutes
+// can be overridden at build time (e.g. in build_opt.h), 3 bytes of RAM per sample
+#ifndef ROLLING_BUFFER_LENGTH
+#define ROLLING_BUFFER_LENGTH 800 // 40 minutes
+#endif
+
+// downsampled history kept after raw samples are overwritten, 10 bytes of RAM per record
+#ifndef MINUTE_HISTORY_LENGTH
+#define MINUTE_HISTORY_LENGTH 60 // 1 hour
+#endif
+#ifndef TEN_MINUTE_HISTORY_LENGTH
+#define TEN_MINUTE_HISTORY_LENGTH 18 // 3 hours
+#endif
+#ifndef HOUR_HISTORY_LENGTH
+#define HOUR_HISTORY_LENGTH 24 // 1 day
+#endif
+
+#define SAMPLES_PER_MINUTE 20
+#define SAMPLES_PER_TEN_MINUTES (10 * SAMPLES_PER_MINUTE)
+#define SAMPLES_PER_HOUR (60 * SAMPLES_PER_MINUTE)
+
+#if ROLLING_BUFFER_LENGTH < SAMPLES_PER_MINUTE || MINUTE_HISTORY_LENGTH < 10 || TEN_MINUTE_HISTORY_LENGTH < 6
+#error "each history tier must cover at least one period of the next tier"
+#endif
+
+#define PACKED_SAMPLE_MAX_PULSES 0x7FFF
+
+// candidates kept for the sliding gust and lull, 4 bytes of RAM each, twice
+// a deque only overflows when speed changes monotonically by more than this many pulses within the window,
+// the window is then rescanned once the candidates kept have expired, not at each sample
+#ifndef EXTREMES_DEQUE_LENGTH
+#define EXTREMES_DEQUE_LENGTH 32
+#endif
+#if EXTREMES_DEQUE_LENGTH > 255
+#error "EXTREMES_DEQUE_LENGTH must fit 8 bits"
+#endif
+
+// speed percentiles of the window, off by default: the histogram takes 272 bytes of RAM
+#ifndef WIND_SPEED_PERCENTILES
+#define WIND_SPEED_PERCENTILES 0
+#endif
+
+// histogram of the samples of the window for speed percentiles, 2 bytes of RAM per bucket: one bucket
+// per pulse count below 64 (exact up to ~28 m/s), then 8 buckets per octave up to 32767 pulses.
+// A percentile is exact while the samples around it are below 64 pulses, above it is off by less than
+// the width of their bucket, at most 1/8 of the value (12.5%). Checked against a sort by test_percentiles.
+#define HISTOGRAM_LINEAR_BUCKETS 64
+#define HISTOGRAM_BUCKETS_PER_OCTAVE 8
+#define HISTOGRAM_FIRST_SHIFT 3 // log2(HISTOGRAM_LINEAR_BUCKETS / HISTOGRAM_BUCKETS_PER_OCTAVE)
+#define HISTOGRAM_BUCKETS (HISTOGRAM_LINEAR_BUCKETS + 9 * HISTOGRAM_BUCKETS_PER_OCTAVE)
 
 typedef struct
 {
-  volatile uint16_t pulses = 0;
-  volatile uint16_t dir = 0;
+  uint16_t pulses = 0;
+  uint16_t dir = 0;
   bool valid = true;
 } wn_raw_wind_sample_t;
 
+// storage format of samples in the rolling buffer: 9 bits direction then 15 bits pulses
+// (saturated at PACKED_SAMPLE_MAX_PULSES), only valid samples are stored
+typedef struct
+{
+  uint8_t bytes[3];
+} wn_packed_wind_sample_t;
+
+// sums of the samples of the minute in progress
+// int32 sums hold a minute as long as samples stay below 3276 pulses (~1400 m/s)
+typedef struct
+{
+  int32_t x = 0; // sum of pulses * cos(dir), Q15
+  int32_t y = 0; // sum of pulses * sin(dir), Q15
+  uint16_t cnt = 0;
+  uint16_t pulses_min = 0xFFFF;
+  uint16_t pulses_max = 0;
+} wn_raw_wind_aggregate_t;
+
+// a closed minute, 10 minutes or hour: mean vector rather than sums, so any period fits 16 bits
+typedef struct
+{
+  int16_t x = 0; // mean of pulses * cos(dir), Q6
+  int16_t y = 0; // mean of pulses * sin(dir), Q6
+  uint16_t cnt = 0;
+  uint16_t pulses_min = 0xFFFF;
+  uint16_t pulses_max = 0;
+} wn_raw_wind_history_t;
+
+// sliding maximum or minimum of the recent samples: monotonic deque of candidates, oldest first
+typedef struct
+{
+  uint16_t seq[EXTREMES_DEQUE_LENGTH]; // low 16 bits of sample sequence numbers
+  uint16_t pulses[EXTREMES_DEQUE_LENGTH];
+  uint8_t first = 0;
+  uint8_t length = 0;
+  bool incomplete = false; // a candidate was left out because the deque was full
+  uint16_t left_out = 0;   // highest (lowest) candidate left out, newer than the ones kept before it
+} wn_sliding_extreme_t;
+
+class WN_VECTOR_AVERAGER;
+
 class WN_ROLLINGBUFFER
 {
 
@@ -26,9 +115,39 @@ public:
 
   void addRawSample(wn_raw_wind_sample_t &raw_sample);
   wn_raw_wind_sample_t get(size_t index);
+  void accumulateRange(WN_VECTOR_AVERAGER &averager, size_t index, size_t length, bool raw_samples_only = false);
+  uint32_t getTotalSamples();
+  uint32_t getClosedMinutes();
+  bool getClosedMinute(size_t index, wn_raw_wind_history_t *record);
+  void setExtremesWindow(size_t length);
+  uint16_t getWindowMaxPulses();
+  uint16_t getWindowMinPulses();
+#if WIND_SPEED_PERCENTILES
+  float getWindowPulsesPercentile(float percent);
+#endif
+  float getWindowMeanPulses();
 
 private:
-  wn_raw_wind_sample_t samples[ROLLING_BUFFER_LENGTH];
+  wn_packed_wind_sample_t samples[ROLLING_BUFFER_LENGTH];
+  wn_raw_wind_aggregate_t current_minute;
+  wn_raw_wind_history_t minutes[MINUTE_HISTORY_LENGTH];
+  wn_raw_wind_history_t ten_minutes[TEN_MINUTE_HISTORY_LENGTH];
+  wn_raw_wind_history_t hours[HOUR_HISTORY_LENGTH];
   size_t head = 0;
   size_t count = 0;
-};
\ No newline at end of file
+  uint32_t total = 0; // samples added since start, history records are indexed from it
+  size_t extremes_window = 0;
+  wn_sliding_extreme_t window_max;
+  wn_sliding_extreme_t window_min;
+#if WIND_SPEED_PERCENTILES
+  uint16_t window_histogram[HISTOGRAM_BUCKETS];
+#endif
+  uint32_t window_pulses_sum = 0;
+
+  const wn_raw_wind_history_t *findHistory(size_t index, size_t end, size_t *span);
+  void updateExtremes(uint16_t pulses);
+  void rebuildExtremes();
+#if WIND_SPEED_PERCENTILES
+  float windowOrderStatistic(uint16_t rank);
+#endif
+};
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Windnerd_Serial_Queue.h"
+
+WN_SERIAL_QUEUE::WN_SERIAL_QUEUE(Print *serial)
+    : _serial(serial)
+{
+}
+
+size_t WN_SERIAL_QUEUE::write(uint8_t c)
+{
+  if (_length == SERIAL_QUEUE_LENGTH)
+  {
+    loop();
+  }
+  if (_length == SERIAL_QUEUE_LENGTH)
+  {
+    _dropped++;
+    return 0;
+  }
+  _queue[(_head + _length) % SERIAL_QUEUE_LENGTH] = c;
+  _length++;
+  return 1;
+}
+
+int WN_SERIAL_QUEUE::availableForWrite()
+{
+  return SERIAL_QUEUE_LENGTH - _length;
+}
+
+// hand queued bytes to the serial port as far as its TX buffer has room, to be called from the sketch loop()
+void WN_SERIAL_QUEUE::loop()
+{
+  int room = _serial->availableForWrite();
+  while (_length > 0 && room > 0)
+  {
+    _serial->write(_queue[_head]);
+    _head = (_head + 1) % SERIAL_QUEUE_LENGTH;
+    _length--;
+    room--;
+  }
+}
+
+// blocking, waits until every queued byte has been sent (e.g. before going to deep sleep)
+void WN_SERIAL_QUEUE::flush()
+{
+  while (_length > 0)
+  {
+    loop();
+  }
+  _serial->flush();
+}
+
+uint16_t WN_SERIAL_QUEUE::getPendingBytes()
+{
+  return _length;
+}
+
+// bytes lost because the queue was full, the output is too slow for what is printed
+uint32_t WN_SERIAL_QUEUE::getDroppedBytes()
+{
+  return _dropped;
+}
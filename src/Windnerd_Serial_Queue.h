@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include "Arduino.h"
+
+// bytes waiting for the serial port, can be changed at build time (e.g. -DSERIAL_QUEUE_LENGTH=512 in build_opt.h)
+#ifndef SERIAL_QUEUE_LENGTH
+#define SERIAL_QUEUE_LENGTH 256
+#endif
+
+// Non-blocking output to a serial port, to print from the wind callbacks.
+// Bytes are queued and handed to the serial TX buffer only as far as it has room, the TX interrupt
+// sends them in the background. A print never waits for the UART: when the queue is full, bytes are
+// dropped and counted instead.
+class WN_SERIAL_QUEUE : public Print
+{
+
+public:
+  WN_SERIAL_QUEUE(Print *serial);
+
+  size_t write(uint8_t c);
+  using Print::write;
+  int availableForWrite();
+  void flush();
+  void loop();
+
+  uint16_t getPendingBytes();
+  uint32_t getDroppedBytes();
+
+private:
+  Print *_serial;
+  uint8_t _queue[SERIAL_QUEUE_LENGTH];
+  uint16_t _head = 0; // next byte to send
+  uint16_t _length = 0;
+  uint32_t _dropped = 0;
+};
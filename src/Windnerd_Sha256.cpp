@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Windnerd_Sha256.h"
+
+static const uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t rotr(uint32_t x, uint8_t n)
+{
+  return (x >> n) | (x << (32 - n));
+}
+
+void WN_SHA256::begin()
+{
+  _state[0] = 0x6a09e667;
+  _state[1] = 0xbb67ae85;
+  _state[2] = 0x3c6ef372;
+  _state[3] = 0xa54ff53a;
+  _state[4] = 0x510e527f;
+  _state[5] = 0x9b05688c;
+  _state[6] = 0x1f83d9ab;
+  _state[7] = 0x5be0cd19;
+  _length = 0;
+}
+
+// message schedule computed in place over 16 words to save RAM
+void WN_SHA256::compress()
+{
+  uint32_t w[16];
+  for (uint8_t i = 0; i < 16; i++)
+  {
+    w[i] = (uint32_t)_block[4 * i] << 24 | (uint32_t)_block[4 * i + 1] << 16 | (uint32_t)_block[4 * i + 2] << 8 | _block[4 * i + 3];
+  }
+
+  uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3];
+  uint32_t e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+
+  for (uint8_t i = 0; i < 64; i++)
+  {
+    if (i >= 16)
+    {
+      uint32_t w15 = w[(i + 1) & 15];
+      uint32_t w2 = w[(i + 14) & 15];
+      uint32_t s0 = rotr(w15, 7) ^ rotr(w15, 18) ^ (w15 >> 3);
+      uint32_t s1 = rotr(w2, 17) ^ rotr(w2, 19) ^ (w2 >> 10);
+      w[i & 15] += s0 + w[(i + 9) & 15] + s1;
+    }
+    uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + round_constants[i] + w[i & 15];
+    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  _state[0] += a;
+  _state[1] += b;
+  _state[2] += c;
+  _state[3] += d;
+  _state[4] += e;
+  _state[5] += f;
+  _state[6] += g;
+  _state[7] += h;
+}
+
+void WN_SHA256::update(const uint8_t *data, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    _block[_length % SHA256_BLOCK_SIZE] = data[i];
+    _length++;
+    if (_length % SHA256_BLOCK_SIZE == 0)
+    {
+      compress();
+    }
+  }
+}
+
+void WN_SHA256::finish(uint8_t digest[SHA256_DIGEST_SIZE])
+{
+  uint64_t bits = (uint64_t)_length * 8;
+  uint8_t used = _length % SHA256_BLOCK_SIZE;
+
+  // padding: 0x80, zeros, then the message length in bits on the last 8 bytes of a block
+  _block[used++] = 0x80;
+  if (used > SHA256_BLOCK_SIZE - 8)
+  {
+    memset(_block + used, 0, SHA256_BLOCK_SIZE - used);
+    compress();
+    used = 0;
+  }
+  memset(_block + used, 0, SHA256_BLOCK_SIZE - 8 - used);
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    _block[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bits >> (8 * i));
+  }
+  compress();
+
+  for (uint8_t i = 0; i < SHA256_DIGEST_SIZE; i++)
+  {
+    digest[i] = (uint8_t)(_state[i / 4] >> (24 - 8 * (i % 4)));
+  }
+}
+
+// both pads are hashed right away, the key is not kept
+void WN_HMAC_SHA256::begin(const uint8_t *key, size_t key_length)
+{
+  uint8_t pad[SHA256_BLOCK_SIZE];
+  memset(pad, 0, sizeof(pad));
+  if (key_length > SHA256_BLOCK_SIZE)
+  {
+    _inner.begin();
+    _inner.update(key, key_length);
+    _inner.finish(pad);
+  }
+  else
+  {
+    memcpy(pad, key, key_length);
+  }
+
+  for (uint8_t i = 0; i < SHA256_BLOCK_SIZE; i++)
+  {
+    pad[i] ^= 0x36;
+  }
+  _inner.begin();
+  _inner.update(pad, SHA256_BLOCK_SIZE);
+
+  for (uint8_t i = 0; i < SHA256_BLOCK_SIZE; i++)
+  {
+    pad[i] ^= 0x36 ^ 0x5c;
+  }
+  _outer.begin();
+  _outer.update(pad, SHA256_BLOCK_SIZE);
+}
+
+void WN_HMAC_SHA256::update(const uint8_t *data, size_t length)
+{
+  _inner.update(data, length);
+}
+
+void WN_HMAC_SHA256::finish(uint8_t mac[SHA256_DIGEST_SIZE])
+{
+  uint8_t inner_digest[SHA256_DIGEST_SIZE];
+  _inner.finish(inner_digest);
+  _outer.update(inner_digest, SHA256_DIGEST_SIZE);
+  _outer.finish(mac);
+}
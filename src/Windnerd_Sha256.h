@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include "Arduino.h"
+
+#define SHA256_BLOCK_SIZE 64
+#define SHA256_DIGEST_SIZE 32
+
+// Compact SHA-256 (FIPS 180-4), bytes are hashed as they come, only one block is buffered.
+class WN_SHA256
+{
+
+public:
+  void begin();
+  void update(const uint8_t *data, size_t length);
+  void finish(uint8_t digest[SHA256_DIGEST_SIZE]);
+
+private:
+  void compress();
+
+  uint32_t _state[8];
+  uint8_t _block[SHA256_BLOCK_SIZE];
+  uint32_t _length; // bytes hashed, payloads stay far below 4 GB
+};
+
+// HMAC-SHA256 (RFC 2104) of a stream of bytes
+class WN_HMAC_SHA256
+{
+
+public:
+  void begin(const uint8_t *key, size_t key_length);
+  void update(const uint8_t *data, size_t length);
+  void finish(uint8_t mac[SHA256_DIGEST_SIZE]);
+
+private:
+  WN_SHA256 _inner;
+  WN_SHA256 _outer;
+};
@@ -14,6 +14,7 @@
 static uint8_t _scl_pin = 0;
 static uint8_t _sda_pin = 0;
 static uint8_t _i2c_error = 0;
+static uint8_t _int_pin = NO_ANGLE_SENSOR_INT_PIN;
 
 
 // Bitbang the I2C bus to release a slave stuck holding SDA low. Pulses SCL up
@@ -62,6 +63,12 @@ static void wn_recover_i2c_bus()
 // values
 #define SAMPLING_8X 0b00001100
 #define ANGLE_FROM_X_Z 0b00001100
+#define INT_MASKED 0b00000001
+#define INT_ON_RESULT_VIA_INT_PIN 0b10000100 // latched until result is read
+
+// non blocking acquisition timings
+#define WAKE_UP_TIME_US 1000
+#define CONVERSION_TIME_US 10000
 
 typedef enum operating_mode
 {
@@ -72,6 +79,16 @@ typedef enum operating_mode
 } operating_mode_t;
 
 
+typedef enum conversion_state
+{
+  CONVERSION_IDLE = 0,
+  CONVERSION_WAKING_UP,
+  CONVERSION_MEASURING
+} conversion_state_t;
+
+static conversion_state_t _conversion_state = CONVERSION_IDLE;
+static uint32_t _conversion_step_micros = 0;
+
 uint8_t wn_get_last_angle_sensor_i2c_error()
 {
   return _i2c_error;
@@ -121,10 +138,17 @@ void wn_read_angle_sensor_register(uint8_t reg, uint8_t *data, size_t length)
   }
 }
 
-void wn_init_angle_sensor(uint8_t scl_pin, uint8_t sda_pin)
+void wn_init_angle_sensor(uint8_t scl_pin, uint8_t sda_pin, uint8_t int_pin)
 {
   _scl_pin = scl_pin;
   _sda_pin = sda_pin;
+  _int_pin = int_pin;
+  _conversion_state = CONVERSION_IDLE;
+
+  if (_int_pin != NO_ANGLE_SENSOR_INT_PIN)
+  {
+    pinMode(_int_pin, INPUT_PULLUP); // INT is open drain, active low
+  }
 
   Wire.begin();
 
@@ -136,11 +160,22 @@ void wn_init_angle_sensor(uint8_t scl_pin, uint8_t sda_pin)
 
   wn_write_angle_sensor_register(SENSOR_CONFIG_2, ANGLE_FROM_X_Z);
   wn_write_angle_sensor_register(DEVICE_CONFIG_1, SAMPLING_8X);
-  wn_write_angle_sensor_register(INT_CONFIG_1, 1);
+  wn_write_angle_sensor_register(INT_CONFIG_1, _int_pin != NO_ANGLE_SENSOR_INT_PIN ? INT_ON_RESULT_VIA_INT_PIN : INT_MASKED);
 
   wn_write_angle_sensor_register(DEVICE_CONFIG_2, OPERATING_MODE_SLEEP);
 }
 
+static uint16_t wn_read_angle_result_then_make_sensor_sleep()
+{
+  uint8_t angle_result[2];
+  wn_read_angle_sensor_register(ANGLE_RESULT_MSB, angle_result, 2);
+
+  wn_write_angle_sensor_register(DEVICE_CONFIG_2, OPERATING_MODE_SLEEP);
+
+  uint16_t raw_angle = (angle_result[0] << 8) + angle_result[1]; // combine 2 bytes as a 16 bits variable
+  return (raw_angle & 0b0001111111111111) >> 4;                  // to 9 bits resolution
+}
+
 uint16_t wn_read_then_make_angle_sensor_sleep()
 {
   uint8_t rx[1];
@@ -149,11 +184,53 @@ uint16_t wn_read_then_make_angle_sensor_sleep()
   wn_write_angle_sensor_register(DEVICE_CONFIG_2, OPERATING_MODE_MEASURE);
   delay(10);
 
-  uint8_t angle_result[2];
-  wn_read_angle_sensor_register(ANGLE_RESULT_MSB, angle_result, 2);
+  return wn_read_angle_result_then_make_sensor_sleep();
+}
 
-  wn_write_angle_sensor_register(DEVICE_CONFIG_2, OPERATING_MODE_SLEEP);
+// Non blocking alternative to wn_read_then_make_angle_sensor_sleep(): start a conversion
+// then call wn_poll_angle_conversion() until the angle is available. Ignored if a conversion is in progress.
+void wn_start_angle_conversion()
+{
+  if (_conversion_state != CONVERSION_IDLE)
+  {
+    return;
+  }
 
-  uint16_t raw_angle = (angle_result[0] << 8) + angle_result[1]; // combine 2 bytes as a 16 bits variable
-  return (raw_angle & 0b0001111111111111) >> 4;                  // to 9 bits resolution
+  uint8_t rx[1];
+  wn_read_angle_sensor_register(DEVICE_CONFIG_2, rx, 1); // wake up the sensor with a read operation
+  _conversion_step_micros = micros();
+  _conversion_state = CONVERSION_WAKING_UP;
+}
+
+bool wn_is_angle_conversion_in_progress()
+{
+  return _conversion_state != CONVERSION_IDLE;
+}
+
+// Move the conversion forward, returns true and sets angle once the result has been read.
+// Conversion end is signaled by the INT pin if one was given, otherwise it is timed.
+bool wn_poll_angle_conversion(uint16_t *angle)
+{
+  uint32_t elapsed = micros() - _conversion_step_micros;
+
+  if (_conversion_state == CONVERSION_WAKING_UP && elapsed >= WAKE_UP_TIME_US)
+  {
+    wn_write_angle_sensor_register(DEVICE_CONFIG_2, OPERATING_MODE_MEASURE);
+    _conversion_step_micros = micros();
+    _conversion_state = CONVERSION_MEASURING;
+    return false;
+  }
+
+  if (_conversion_state == CONVERSION_MEASURING)
+  {
+    bool int_asserted = _int_pin != NO_ANGLE_SENSOR_INT_PIN && digitalRead(_int_pin) == LOW;
+    if (int_asserted || elapsed >= CONVERSION_TIME_US)
+    {
+      *angle = wn_read_angle_result_then_make_sensor_sleep();
+      _conversion_state = CONVERSION_IDLE;
+      return true;
+    }
+  }
+
+  return false;
 }
@@ -9,6 +9,11 @@
 #pragma once
 #include "Arduino.h"
 
-void wn_init_angle_sensor(uint8_t scl_pin, uint8_t sda_pin);
+#define NO_ANGLE_SENSOR_INT_PIN 0xFF
+
+void wn_init_angle_sensor(uint8_t scl_pin, uint8_t sda_pin, uint8_t int_pin = NO_ANGLE_SENSOR_INT_PIN);
 uint16_t wn_read_then_make_angle_sensor_sleep();
+void wn_start_angle_conversion();
+bool wn_poll_angle_conversion(uint16_t *angle);
+bool wn_is_angle_conversion_in_progress();
 uint8_t wn_get_last_angle_sensor_i2c_error();
@@ -7,6 +7,63 @@
  */
 
 #include "Windnerd_Vector_Averager.h"
+#include <math.h>
+
+// STM32G0 has no FPU: averaging is done with integers, sin/cos come from a table
+// and atan2/magnitude from a CORDIC, float is only used once per report
+
+// sin(0..90 degrees) in Q15
+static const int16_t sin_q15_table[91] = {
+    0, 572, 1144, 1715, 2286, 2856, 3425, 3993, 4560, 5126,
+    5690, 6252, 6813, 7371, 7927, 8481, 9032, 9580, 10126, 10668,
+    11207, 11743, 12275, 12803, 13328, 13848, 14365, 14876, 15384, 15886,
+    16384, 16877, 17364, 17847, 18324, 18795, 19261, 19720, 20174, 20622,
+    21063, 21498, 21926, 22348, 22763, 23170, 23571, 23965, 24351, 24730,
+    25102, 25466, 25822, 26170, 26510, 26842, 27166, 27482, 27789, 28088,
+    28378, 28660, 28932, 29197, 29452, 29698, 29935, 30163, 30382, 30592,
+    30792, 30983, 31164, 31336, 31499, 31651, 31795, 31928, 32052, 32166,
+    32270, 32365, 32449, 32524, 32588, 32643, 32688, 32723, 32748, 32763,
+    32767};
+
+// atan(2^-i) in degrees * 65536
+#define CORDIC_ITERATIONS 16
+static const int32_t cordic_atan_table[CORDIC_ITERATIONS] = {
+    2949120, 1740967, 919879, 466945, 234379, 117304, 58666, 29335,
+    14668, 7334, 3667, 1833, 917, 458, 229, 115};
+
+#define CORDIC_GAIN_INV_Q15 19898 // 1 / 1.64676 (CORDIC gain)
+#define DEG_180_Q16 (180L << 16)
+
+// sine of an angle in degrees (0-359), Q15
+int32_t wn_sin_q15(uint16_t deg)
+{
+  if (deg >= 360)
+    deg %= 360;
+  if (deg <= 90)
+    return sin_q15_table[deg];
+  if (deg <= 180)
+    return sin_q15_table[180 - deg];
+  if (deg <= 270)
+    return -sin_q15_table[deg - 180];
+  return -sin_q15_table[360 - deg];
+}
+
+int32_t wn_cos_q15(uint16_t deg)
+{
+  return wn_sin_q15(deg + 90);
+}
+
+// add a sample to the sums of the minute in progress kept by the rolling buffer
+void wn_aggregate_sample(wn_raw_wind_aggregate_t &aggregate, wn_raw_wind_sample_t &sample)
+{
+  aggregate.x += (int32_t)sample.pulses * wn_cos_q15(sample.dir);
+  aggregate.y += (int32_t)sample.pulses * wn_sin_q15(sample.dir);
+  aggregate.cnt++;
+  if (sample.pulses > aggregate.pulses_max)
+    aggregate.pulses_max = sample.pulses;
+  if (sample.pulses < aggregate.pulses_min)
+    aggregate.pulses_min = sample.pulses;
+}
 
 WN_VECTOR_AVERAGER::WN_VECTOR_AVERAGER()
 {
@@ -19,12 +76,20 @@ void WN_VECTOR_AVERAGER::accumulate(wn_raw_wind_sample_t sample)
 
 void WN_VECTOR_AVERAGER::accumulate(uint32_t pulses, uint16_t dir)
 {
-  // Convert dir (degrees) into radians
-  float rad = dir * (M_PI / 180.0f);
-
   // Add to vector components (weighted by pulses = speed proxy)
-  x += pulses * cosf(rad);
-  y += pulses * sinf(rad);
+  int32_t cos_q15 = wn_cos_q15(dir);
+  int32_t sin_q15 = wn_sin_q15(dir);
+  x += (int64_t)pulses * cos_q15;
+  y += (int64_t)pulses * sin_q15;
+
+#if WIND_EXTENDED_STATISTICS
+  raw_cnt++;
+  pulses_sum += pulses;
+  pulses_square_sum += (uint64_t)pulses * pulses;
+  unit_x += cos_q15;
+  unit_y += sin_q15;
+  unit_square_sum += (uint32_t)(cos_q15 * cos_q15 + sin_q15 * sin_q15) >> 15;
+#endif
 
   // Track counts and min/max
   cnt++;
@@ -34,27 +99,163 @@ void WN_VECTOR_AVERAGER::accumulate(uint32_t pulses, uint16_t dir)
     wind_min = pulses;
 }
 
-void WN_VECTOR_AVERAGER::computeReportFromAccumulatedValues(wn_raw_wind_report_t *report)
+// merge sums of several samples, as if each of them was accumulated
+void WN_VECTOR_AVERAGER::accumulate(const wn_raw_wind_aggregate_t &aggregate)
 {
-  if (cnt == 0)
+  if (aggregate.cnt == 0)
+    return;
+
+  x += aggregate.x;
+  y += aggregate.y;
+  cnt += aggregate.cnt;
+  if (aggregate.pulses_max > wind_max)
+    wind_max = aggregate.pulses_max;
+  if (aggregate.pulses_min < wind_min)
+    wind_min = aggregate.pulses_min;
+}
+
+// merge a history record (Q6 mean vector) as if each of its samples was accumulated
+void WN_VECTOR_AVERAGER::accumulate(const wn_raw_wind_history_t &record)
+{
+  if (record.cnt == 0)
+    return;
+
+  x += ((int64_t)record.x * record.cnt) << 9;
+  y += ((int64_t)record.y * record.cnt) << 9;
+  cnt += record.cnt;
+  if (record.pulses_max > wind_max)
+    wind_max = record.pulses_max;
+  if (record.pulses_min < wind_min)
+    wind_min = record.pulses_min;
+}
+
+// CORDIC in vectoring mode: returns atan2(y, x) in degrees * 65536 (-180..180)
+// and replaces x with the vector magnitude multiplied by the CORDIC gain.
+// |x| and |y| must be below 2^29 so the gain cannot overflow.
+static int32_t cordic_atan2(int32_t &x, int32_t y)
+{
+  int32_t angle = 0;
+
+  // rotate into the right half-plane, CORDIC converges only for |angle| < 99 degrees
+  if (x < 0)
+  {
+    x = -x;
+    y = -y;
+    angle = (y > 0) ? DEG_180_Q16 : -DEG_180_Q16;
+  }
+
+  for (uint8_t i = 0; i < CORDIC_ITERATIONS; i++)
+  {
+    int32_t x_shifted = x >> i;
+    int32_t y_shifted = y >> i;
+    if (y > 0)
+    {
+      x += y_shifted;
+      y -= x_shifted;
+      angle += cordic_atan_table[i];
+    }
+    else
+    {
+      x -= y_shifted;
+      y += x_shifted;
+      angle -= cordic_atan_table[i];
+    }
+  }
+  return angle;
+}
+
+#if WIND_EXTENDED_STATISTICS
+// Scalar mean, standard deviation of pulses and direction standard deviation of the samples accumulated
+// one by one, from the sums kept in the same pass. To be called before computeReportFromAccumulatedValues().
+void WN_VECTOR_AVERAGER::computeStatisticsFromAccumulatedValues(wn_raw_wind_statistics_t *statistics)
+{
+  statistics->cnt = raw_cnt;
+  if (raw_cnt == 0)
   {
     return;
   }
 
-  // Average vector direction
-  float avgX = x / cnt;
-  float avgY = y / cnt;
-  float dir = atan2f(avgY, avgX) * 180.0f / M_PI;
-  if (dir < 0)
+  statistics->pulses_scalar_avg = (float)pulses_sum / raw_cnt;
+  uint64_t variance_n2 = (uint64_t)raw_cnt * pulses_square_sum - (uint64_t)pulses_sum * pulses_sum;
+  statistics->pulses_std_dev = sqrtf((float)variance_n2) / raw_cnt;
+
+  // Yamartino: epsilon = sqrt(1 - (mean sin^2 + mean cos^2)), sigma = asin(epsilon) * (1 + (2 / sqrt(3) - 1) * epsilon^3)
+  float mean_x = (float)unit_x / (32768.0f * raw_cnt);
+  float mean_y = (float)unit_y / (32768.0f * raw_cnt);
+  // relative to the mean squared length of the unit vectors, so table rounding does not read as spread
+  float unit_square_avg = (float)unit_square_sum / (32768.0f * raw_cnt);
+  float epsilon_square = 1.0f - (mean_x * mean_x + mean_y * mean_y) / unit_square_avg;
+  float epsilon = epsilon_square > 0 ? sqrtf(epsilon_square) : 0;
+  if (epsilon > 1.0f)
   {
-    dir += 360.0f;
+    epsilon = 1.0f;
   }
+  statistics->dir_std_dev = asinf(epsilon) * (1.0f + 0.1547005f * epsilon * epsilon * epsilon) * (180.0f / (float)M_PI);
+}
+#endif
 
-  report->pulses_avg = sqrtf(avgX * avgX + avgY * avgY);
-  report->dir_avg = (uint16_t)(dir + 0.5f);
-  report->pulses_max = wind_max;
-  report->pulses_min = wind_min;
+void WN_VECTOR_AVERAGER::computeReportFromAccumulatedValues(wn_raw_wind_report_t *report)
+{
+  if (cnt == 0)
+  {
+    return;
+  }
+
+  int64_t sum_x = x;
+  int64_t sum_y = y;
+  uint32_t sample_cnt = cnt;
   x = 0;
   y = 0;
   cnt = 0;
+#if WIND_EXTENDED_STATISTICS
+  raw_cnt = 0;
+  pulses_sum = 0;
+  pulses_square_sum = 0;
+  unit_x = 0;
+  unit_y = 0;
+  unit_square_sum = 0;
+#endif
+
+  report->pulses_max = wind_max;
+  report->pulses_min = wind_min;
+
+  if (sum_x == 0 && sum_y == 0)
+  {
+    report->pulses_avg = 0;
+    report->dir_avg = 0;
+    return;
+  }
+
+  // scale the summed vector so its largest component sits between 2^28 and 2^29,
+  // direction does not depend on the scale and magnitude is scaled back below
+  int8_t shift = 0;
+  int64_t abs_x = sum_x < 0 ? -sum_x : sum_x;
+  int64_t abs_y = sum_y < 0 ? -sum_y : sum_y;
+  int64_t largest = abs_x > abs_y ? abs_x : abs_y;
+  while (largest >= (1L << 29))
+  {
+    largest >>= 1;
+    shift++;
+  }
+  while (largest < (1L << 28))
+  {
+    largest <<= 1;
+    shift--;
+  }
+  int32_t cx = (int32_t)(shift >= 0 ? sum_x >> shift : sum_x << -shift);
+  int32_t cy = (int32_t)(shift >= 0 ? sum_y >> shift : sum_y << -shift);
+
+  // Average vector direction, rounded to the nearest degree
+  int32_t angle = cordic_atan2(cx, cy);
+  int32_t dir = (angle + (1L << 15)) >> 16;
+  if (dir < 0)
+  {
+    dir += 360;
+  }
+  report->dir_avg = dir % 360;
+
+  // vector magnitude in pulses * Q15, then averaged over samples
+  int64_t magnitude = ((int64_t)cx * CORDIC_GAIN_INV_Q15) >> 15;
+  magnitude = shift >= 0 ? magnitude << shift : magnitude >> -shift;
+  report->pulses_avg = (float)magnitude / (32768.0f * sample_cnt);
 }
@@ -9,6 +9,12 @@
 #pragma once
 #include "Windnerd_Rolling_Buffer.h"
 
+// spread of the samples (scalar mean, standard deviations), off by default: 28 bytes of RAM
+// per averager and a few more operations per sample
+#ifndef WIND_EXTENDED_STATISTICS
+#define WIND_EXTENDED_STATISTICS 0
+#endif
+
 typedef struct
 {
   float pulses_avg = 0;
@@ -17,6 +23,25 @@ typedef struct
   uint32_t pulses_min = 0;
 } wn_raw_wind_report_t;
 
+#if WIND_EXTENDED_STATISTICS
+// spread of the raw samples accumulated one by one, merged sums and history records have none
+typedef struct
+{
+  float pulses_scalar_avg = 0; // mean of sample pulses, unlike pulses_avg not reduced when direction changes
+  float pulses_std_dev = 0;
+  float dir_std_dev = 0; // Yamartino estimate, degrees
+  uint32_t cnt = 0;
+} wn_raw_wind_statistics_t;
+#endif
+
+int32_t wn_sin_q15(uint16_t deg);
+int32_t wn_cos_q15(uint16_t deg);
+void wn_aggregate_sample(wn_raw_wind_aggregate_t &aggregate, wn_raw_wind_sample_t &sample);
+
+// Vector mean of the samples with integer sums, a Q15 sin/cos table and a CORDIC atan2, no float per sample.
+// Against a double precision mean (extras/host_tests/test_vector_averager.cpp), the direction is off by
+// at most 0.504 degree including the rounding to a degree (0.500 for the float version it replaces),
+// and the speed by at most 0.024% (20 samples), 0.006% (1200 samples).
 class WN_VECTOR_AVERAGER
 {
 
@@ -25,12 +50,28 @@ public:
 
   void accumulate(uint32_t pulses, uint16_t dir);
   void accumulate(wn_raw_wind_sample_t sample);
+  void accumulate(const wn_raw_wind_aggregate_t &aggregate);
+  void accumulate(const wn_raw_wind_history_t &record);
+#if WIND_EXTENDED_STATISTICS
+  void computeStatisticsFromAccumulatedValues(wn_raw_wind_statistics_t *statistics);
+#endif
   void computeReportFromAccumulatedValues(wn_raw_wind_report_t *report);
 
 private:
-  float x = 0;
-  float y = 0;
+  // vector components in pulses * Q15, wide enough for a full rolling buffer
+  int64_t x = 0;
+  int64_t y = 0;
   uint32_t cnt = 0;
   uint32_t wind_max = 0;
   uint32_t wind_min = 0xFFFFFFFF;
+#if WIND_EXTENDED_STATISTICS
+  // single pass sums of the samples accumulated one by one: pulses, pulses squared, unit direction vector in Q15
+  // integers keep the variance exact (no cancellation) without a float division per sample
+  uint32_t raw_cnt = 0;
+  uint32_t pulses_sum = 0;
+  uint64_t pulses_square_sum = 0;
+  int32_t unit_x = 0;
+  int32_t unit_y = 0;
+  uint32_t unit_square_sum = 0; // squared length of the table unit vectors, Q15: they are not exactly 1
+#endif
 };
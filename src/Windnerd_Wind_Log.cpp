@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Windnerd_Wind_Log.h"
+#include "Windnerd_Crc.h"
+
+#define PAGE_MAGIC 0x574E4C47UL // "WNLG"
+#define FLAG_AFTER_REBOOT 0x01
+
+// a logged minute, programmed as 2 double words
+typedef struct
+{
+  uint32_t seq;
+  int16_t x;
+  int16_t y;
+  uint16_t pulses_min;
+  uint16_t pulses_max;
+  uint8_t cnt;
+  uint8_t flags;
+  uint16_t crc; // of the 14 previous bytes
+} log_slot_t;
+
+static_assert(sizeof(log_slot_t) == WIND_LOG_SLOT_SIZE, "log slot must be 2 double words");
+
+static uint16_t slotOffset(uint16_t slot)
+{
+  return (slot + 1) * WIND_LOG_SLOT_SIZE;
+}
+
+// A double word torn by a power loss fails its ECC check. It is programmed to 0, which is allowed over any
+// content, so that it reads as an invalid header or slot from now on without raising the ECC error again.
+static bool readDoubleword(uint8_t page, uint16_t offset, uint64_t *data)
+{
+  if (wn_flash_read_log_doubleword(page, offset, data))
+  {
+    return true;
+  }
+  wn_flash_program_log_doubleword(page, offset, 0);
+  *data = 0;
+  return false;
+}
+
+// true if the sequence number a is after b, wraparound safe
+static bool isAfter(uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b) > 0;
+}
+
+WN_WIND_LOG::WN_WIND_LOG()
+{
+}
+
+bool WN_WIND_LOG::readPageHeader(uint8_t page, uint32_t *generation, uint32_t *first_seq)
+{
+  uint64_t word0, word1;
+  if (!readDoubleword(page, 0, &word0) || !readDoubleword(page, 8, &word1) || (uint32_t)word0 != PAGE_MAGIC || (uint32_t)word1 != (uint32_t)~(word1 >> 32))
+  {
+    return false;
+  }
+  *generation = word0 >> 32;
+  *first_seq = word1 >> 32;
+  return true;
+}
+
+bool WN_WIND_LOG::startPage(uint8_t page, uint32_t generation, uint32_t first_seq)
+{
+  if (!wn_flash_erase_log_page(page))
+  {
+    return false;
+  }
+  uint64_t word0 = ((uint64_t)generation << 32) | PAGE_MAGIC;
+  uint64_t word1 = ((uint64_t)first_seq << 32) | (uint32_t)~first_seq;
+  // first_seq is written last: a page with a torn header is ignored and erased again when reused
+  if (!wn_flash_program_log_doubleword(page, 0, word0) || !wn_flash_program_log_doubleword(page, 8, word1))
+  {
+    return false;
+  }
+  active_page = page;
+  active_page_generation = generation;
+  active_page_first_seq = first_seq;
+  next_slot = 0;
+  has_active_page = true;
+  return true;
+}
+
+// find the most recently started page and the first free slot in it,
+// false if the log pages are not free (sketch too large), nothing is logged then
+bool WN_WIND_LOG::begin()
+{
+  has_active_page = false;
+  rebooted = true;
+  started = false;
+  if (!wn_flash_log_pages_free())
+  {
+    return false;
+  }
+
+  for (uint8_t page = 0; page < WIND_LOG_FLASH_PAGES; page++)
+  {
+    uint32_t generation, first_seq;
+    if (readPageHeader(page, &generation, &first_seq) && (!has_active_page || isAfter(generation, active_page_generation)))
+    {
+      has_active_page = true;
+      active_page = page;
+      active_page_generation = generation;
+      active_page_first_seq = first_seq;
+    }
+  }
+
+  next_slot = WIND_LOG_SLOTS_PER_PAGE;
+  if (has_active_page)
+  {
+    // slots are written in order, the first erased one is where logging resumes,
+    // torn slots before it keep their sequence number and read as missing
+    for (uint16_t slot = 0; slot < WIND_LOG_SLOTS_PER_PAGE; slot++)
+    {
+      uint64_t word0, word1;
+      if (readDoubleword(active_page, slotOffset(slot), &word0) && word0 == WN_FLASH_ERASED_DOUBLEWORD &&
+          readDoubleword(active_page, slotOffset(slot) + 8, &word1) && word1 == WN_FLASH_ERASED_DOUBLEWORD)
+      {
+        next_slot = slot;
+        break;
+      }
+    }
+  }
+  started = true;
+  return true;
+}
+
+bool WN_WIND_LOG::append(const wn_raw_wind_history_t &minute)
+{
+  if (!started)
+  {
+    return false;
+  }
+
+  if (next_slot >= WIND_LOG_SLOTS_PER_PAGE)
+  {
+    // wear leveling: pages are used in turn, the oldest one is erased for the new records
+    uint8_t page = has_active_page ? (active_page + 1) % WIND_LOG_FLASH_PAGES : 0;
+    uint32_t generation = has_active_page ? active_page_generation + 1 : 0;
+    uint32_t first_seq = has_active_page ? active_page_first_seq + WIND_LOG_SLOTS_PER_PAGE : 0;
+    if (!startPage(page, generation, first_seq))
+    {
+      return false; // retried on next append
+    }
+  }
+
+  log_slot_t slot;
+  slot.seq = active_page_first_seq + next_slot;
+  slot.x = minute.x;
+  slot.y = minute.y;
+  slot.pulses_min = minute.pulses_min;
+  slot.pulses_max = minute.pulses_max;
+  slot.cnt = minute.cnt;
+  slot.flags = rebooted ? FLAG_AFTER_REBOOT : 0;
+  slot.crc = wn_crc16((const uint8_t *)&slot, sizeof(slot) - sizeof(slot.crc));
+
+  uint64_t words[2];
+  memcpy(words, &slot, sizeof(words));
+  uint16_t offset = slotOffset(next_slot);
+  next_slot++; // a failed or torn slot is not reused
+  if (!wn_flash_program_log_doubleword(active_page, offset, words[0]) ||
+      !wn_flash_program_log_doubleword(active_page, offset + 8, words[1]))
+  {
+    return false;
+  }
+  rebooted = false;
+  return true;
+}
+
+// oldest sequence number still in flash
+uint32_t WN_WIND_LOG::getFirstSeq()
+{
+  uint32_t first = getEndSeq();
+  for (uint8_t page = 0; page < WIND_LOG_FLASH_PAGES; page++)
+  {
+    uint32_t generation, first_seq;
+    if (readPageHeader(page, &generation, &first_seq) && isAfter(first, first_seq))
+    {
+      first = first_seq;
+    }
+  }
+  return first;
+}
+
+// sequence number the next appended minute will get
+uint32_t WN_WIND_LOG::getEndSeq()
+{
+  if (!has_active_page)
+  {
+    return 0;
+  }
+  return active_page_first_seq + next_slot;
+}
+
+// read a logged minute, false if it is not in flash anymore, was never written or was torn
+bool WN_WIND_LOG::read(uint32_t seq, wn_wind_log_record_t *record)
+{
+  if (!has_active_page || !isAfter(getEndSeq(), seq))
+  {
+    return false;
+  }
+
+  for (uint8_t page = 0; page < WIND_LOG_FLASH_PAGES; page++)
+  {
+    uint32_t generation, first_seq;
+    if (!readPageHeader(page, &generation, &first_seq) || isAfter(first_seq, seq) || seq - first_seq >= WIND_LOG_SLOTS_PER_PAGE)
+    {
+      continue;
+    }
+
+    log_slot_t slot;
+    uint64_t words[2];
+    uint16_t offset = slotOffset(seq - first_seq);
+    if (!readDoubleword(page, offset, &words[0]) || !readDoubleword(page, offset + 8, &words[1]))
+    {
+      return false;
+    }
+    memcpy(&slot, words, sizeof(slot));
+    if (slot.seq != seq || slot.crc != wn_crc16((const uint8_t *)&slot, sizeof(slot) - sizeof(slot.crc)))
+    {
+      return false;
+    }
+
+    record->seq = seq;
+    record->after_reboot = slot.flags & FLAG_AFTER_REBOOT;
+    record->minute.x = slot.x;
+    record->minute.y = slot.y;
+    record->minute.cnt = slot.cnt;
+    record->minute.pulses_min = slot.pulses_min;
+    record->minute.pulses_max = slot.pulses_max;
+    return true;
+  }
+  return false;
+}
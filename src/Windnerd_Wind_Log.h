@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include "Arduino.h"
+#include "Windnerd_Rolling_Buffer.h"
+#include "Windnerd_Flash.h"
+
+#define WIND_LOG_SLOT_SIZE 16
+#define WIND_LOG_SLOTS_PER_PAGE (WN_FLASH_PAGE_SIZE / WIND_LOG_SLOT_SIZE - 1) // first slot is the page header
+
+typedef struct
+{
+  uint32_t seq = 0;           // minute sequence number, keeps increasing across reboots
+  bool after_reboot = false;  // first minute logged after a reboot: the time gap with the previous minute is unknown
+  wn_raw_wind_history_t minute;
+} wn_wind_log_record_t;
+
+// Append-only log of closed minutes in reserved flash pages, used as a ring.
+// Each page starts with a header holding its erase generation and the sequence number of its first slot,
+// so the sequence number of a record is given by its position. Records are written as 2 double words
+// protected by a CRC: a record torn by a power loss is skipped at boot and reads as missing. A torn double word
+// also fails its ECC check, the read returns through wn_flash_handle_ecc_nmi() and the word is zeroed.
+// Minutes are programmed as they close rather than a page at a time: buffering a page would take 2 KB of RAM and
+// lose its minutes on a power loss. A power loss between the 2 programs of a record (~85 us each) loses that minute only,
+// and as each double word is programmed once per erase, this does not add wear.
+class WN_WIND_LOG
+{
+
+public:
+  WN_WIND_LOG();
+
+  bool begin();
+  bool append(const wn_raw_wind_history_t &minute);
+  bool read(uint32_t seq, wn_wind_log_record_t *record);
+  uint32_t getFirstSeq();
+  uint32_t getEndSeq();
+
+private:
+  bool started = false;
+  bool rebooted = true;
+  uint8_t active_page = 0;
+  uint16_t next_slot = WIND_LOG_SLOTS_PER_PAGE; // full page: next append starts a new page
+  uint32_t active_page_generation = 0;
+  uint32_t active_page_first_seq = 0;
+  bool has_active_page = false;
+
+  bool readPageHeader(uint8_t page, uint32_t *generation, uint32_t *first_seq);
+  bool startPage(uint8_t page, uint32_t generation, uint32_t first_seq);
+};
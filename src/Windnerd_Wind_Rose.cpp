@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Windnerd_Wind_Rose.h"
+
+#if WIND_ROSE
+
+// upper limits of the default speed classes, in the speed unit of the anemometer: calm, then steps of 3 units
+static const float default_class_limits[] = {1, 4, 7, 10, 13};
+
+WN_WIND_ROSE::WN_WIND_ROSE()
+{
+  setSpeedClasses(default_class_limits, sizeof(default_class_limits) / sizeof(default_class_limits[0]));
+}
+
+// number of direction sectors, the first one is centered on north, false if the bins don't fit (counts are reset)
+bool WN_WIND_ROSE::setSectors(uint8_t sectors)
+{
+  if (sectors == 0 || sectors > WIND_ROSE_MAX_SECTORS || sectors * (_limits + 1) > WIND_ROSE_MAX_BINS)
+  {
+    return false;
+  }
+  _sectors = sectors;
+  reset();
+  return true;
+}
+
+// speed classes given by increasing upper limits in the speed unit of the anemometer, the last class has no limit:
+// n limits give n + 1 classes, false if they don't fit (counts are reset)
+bool WN_WIND_ROSE::setSpeedClasses(const float *upper_limits, uint8_t limits)
+{
+  if (limits >= WIND_ROSE_MAX_CLASSES || _sectors * (limits + 1) > WIND_ROSE_MAX_BINS)
+  {
+    return false;
+  }
+  for (uint8_t i = 0; i < limits; i++)
+  {
+    _class_limits[i] = upper_limits[i];
+  }
+  _limits = limits;
+  reset();
+  return true;
+}
+
+void WN_WIND_ROSE::add(float speed, uint16_t dir, uint32_t sample_seq)
+{
+  uint8_t sector = ((uint32_t)(dir % 360) * _sectors * 2 + 360) / 720 % _sectors;
+  uint8_t speed_class = 0;
+  while (speed_class < _limits && speed >= _class_limits[speed_class])
+  {
+    speed_class++;
+  }
+  uint16_t &bin = _bins[sector * (_limits + 1) + speed_class];
+  if (bin < UINT16_MAX)
+  {
+    bin++;
+  }
+  _samples++;
+  _last_seq = sample_seq;
+}
+
+// clear counts, sectors and speed classes are kept
+void WN_WIND_ROSE::reset()
+{
+  memset(_bins, 0, sizeof(_bins));
+  _samples = 0;
+}
+
+// copy of the current counts, e.g. before reset() at the end of each hour
+void WN_WIND_ROSE::snapshot(WN_WIND_ROSE *copy)
+{
+  *copy = *this;
+}
+
+uint8_t WN_WIND_ROSE::getSectorCount()
+{
+  return _sectors;
+}
+
+uint8_t WN_WIND_ROSE::getClassCount()
+{
+  return _limits + 1;
+}
+
+float WN_WIND_ROSE::getClassLimit(uint8_t limit_index)
+{
+  return limit_index < _limits ? _class_limits[limit_index] : 0;
+}
+
+// samples of a sector (0 is north, clockwise) and speed class (0 is the slowest)
+uint16_t WN_WIND_ROSE::getCount(uint8_t sector, uint8_t speed_class)
+{
+  if (sector >= _sectors || speed_class > _limits)
+  {
+    return 0;
+  }
+  return _bins[sector * (_limits + 1) + speed_class];
+}
+
+// samples added since the last reset
+uint32_t WN_WIND_ROSE::getSampleCount()
+{
+  return _samples;
+}
+
+// sequence number of the last sample added, see WN_Core::getSampleCount()
+uint32_t WN_WIND_ROSE::getLastSampleSeq()
+{
+  return _last_seq;
+}
+#endif
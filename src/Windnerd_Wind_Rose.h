@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include "Arduino.h"
+
+// wind rose, off by default: WN_Core and WTP payloads only reference it when enabled
+#ifndef WIND_ROSE
+#define WIND_ROSE 0
+#endif
+
+#if WIND_ROSE
+// sectors x speed classes, 2 bytes of RAM per bin: 16 sectors x 6 classes or 36 x 3, can be changed at build time
+#ifndef WIND_ROSE_MAX_BINS
+#define WIND_ROSE_MAX_BINS 108
+#endif
+#define WIND_ROSE_MAX_SECTORS 36
+#define WIND_ROSE_MAX_CLASSES 8
+
+#define WIND_ROSE_DEFAULT_SECTORS 16
+
+// Direction distribution of samples with a speed class breakdown, updated at each sample by WN_Core
+// once attached with attachWindRose(). Counts saturate at 65535 (54 hours of samples in one bin).
+class WN_WIND_ROSE
+{
+
+public:
+  WN_WIND_ROSE();
+
+  bool setSectors(uint8_t sectors);
+  bool setSpeedClasses(const float *upper_limits, uint8_t limits);
+  void add(float speed, uint16_t dir, uint32_t sample_seq);
+  void reset();
+  void snapshot(WN_WIND_ROSE *copy);
+
+  uint8_t getSectorCount();
+  uint8_t getClassCount();
+  float getClassLimit(uint8_t limit_index);
+  uint16_t getCount(uint8_t sector, uint8_t speed_class);
+  uint32_t getSampleCount();
+  uint32_t getLastSampleSeq();
+
+private:
+  uint8_t _sectors = WIND_ROSE_DEFAULT_SECTORS;
+  uint8_t _limits = 0;
+  float _class_limits[WIND_ROSE_MAX_CLASSES - 1];
+  uint16_t _bins[WIND_ROSE_MAX_BINS];
+  uint32_t _samples = 0;
+  uint32_t _last_seq = 0;
+};
+#endif
@@ -13,6 +13,8 @@ WN_WTP_PAYLOAD::WN_WTP_PAYLOAD() {
 
 void WN_WTP_PAYLOAD::reset() {
   _payload_config = {};
+  _replay_log = false;
+  _selected = false;
 }
 void WN_WTP_PAYLOAD::setAnemometer(WN_Core* anemometer) {
   _anemometer = anemometer;
@@ -22,6 +24,134 @@ void WN_WTP_PAYLOAD::setPeriodInMinutes(unsigned period) {
   _period_mn = period;
 }
 
+// report lines are read from the flash wind log (minutes first_seq to end_seq - 1) instead of recent wind,
+// most recent first and stopping at a gap: a missing minute or a reboot
+void WN_WTP_PAYLOAD::replayWindLog(uint32_t first_seq, uint32_t end_seq) {
+  _replay_log = true;
+  _log_first_seq = first_seq;
+  _log_end_seq = end_seq;
+}
+
+// send closed minutes and samples that were not acknowledged yet instead of the last period, oldest first:
+// a payload carries at most max_reports minutes and max_samples samples, following ones are left to the next payloads
+void WN_WTP_PAYLOAD::enableIncrementalUpload(uint16_t max_reports, uint16_t max_samples) {
+  _incremental = true;
+  _max_reports = max_reports;
+  _max_samples = max_samples;
+}
+
+// the last payload sent was received, its minutes and samples won't be sent again
+void WN_WTP_PAYLOAD::acknowledge() {
+  acknowledge(_sent_minute_end, _sent_sample_end);
+}
+
+// minutes before minute_end_seq and samples before sample_end_seq were received
+void WN_WTP_PAYLOAD::acknowledge(uint32_t minute_end_seq, uint32_t sample_end_seq) {
+  if (minute_end_seq > _acked_minute_end) {
+    _acked_minute_end = minute_end_seq;
+  }
+  if (sample_end_seq > _acked_sample_end) {
+    _acked_sample_end = sample_end_seq;
+  }
+}
+
+// sequence numbers following the last minute and the last sample of the last payload sent
+uint32_t WN_WTP_PAYLOAD::getSentMinuteEnd() {
+  return _sent_minute_end;
+}
+
+uint32_t WN_WTP_PAYLOAD::getSentSampleEnd() {
+  return _sent_sample_end;
+}
+
+// more records are waiting than an incremental payload can carry
+bool WN_WTP_PAYLOAD::hasBacklog() {
+  uint32_t minutes = _anemometer->getClosedMinuteCount();
+  uint32_t samples = _anemometer->getSampleCount();
+  uint32_t first_minute = firstAvailable(minutes, WTP_KEPT_MINUTES, _acked_minute_end);
+  uint32_t first_sample = firstAvailable(samples, WTP_KEPT_SAMPLES, _acked_sample_end);
+  return minutes - first_minute > _max_reports || (_payload_config.has_wind_samples && samples - first_sample > _max_samples);
+}
+
+// oldest record still in memory and not acknowledged, records are numbered from 0 at start up
+// kept is reduced by callers so that records selected are still in memory when the payload is sent
+uint32_t WN_WTP_PAYLOAD::firstAvailable(uint32_t end, uint32_t kept, uint32_t acked_end) {
+  uint32_t oldest = end > kept ? end - kept : 0;
+  return acked_end > oldest ? acked_end : oldest;
+}
+
+// choose the minutes and samples of the payload by sequence number, new ones arriving later are ignored
+void WN_WTP_PAYLOAD::selectRecords() {
+  _minute_anchor = _anemometer->getClosedMinuteCount();
+  _sample_anchor = _anemometer->getSampleCount();
+  _minute_end = _minute_anchor;
+  _sample_end = _sample_anchor;
+
+  if (_incremental) {
+    _minute_first = firstAvailable(_minute_end, WTP_KEPT_MINUTES, _acked_minute_end);
+    _sample_first = firstAvailable(_sample_end, WTP_KEPT_SAMPLES, _acked_sample_end);
+    if (_minute_first > _minute_end) {
+      _minute_first = _minute_end;
+    }
+    if (_sample_first > _sample_end) {
+      _sample_first = _sample_end;
+    }
+    // the oldest records go first
+    if (_minute_end - _minute_first > _max_reports) {
+      _minute_end = _minute_first + _max_reports;
+    }
+    if (_sample_end - _sample_first > _max_samples) {
+      _sample_end = _sample_first + _max_samples;
+    }
+  } else {
+    uint32_t minutes = _period_mn < WTP_KEPT_MINUTES ? _period_mn : WTP_KEPT_MINUTES;
+    uint32_t samples = _period_mn * SAMPLES_PER_MINUTE < WTP_KEPT_SAMPLES ? _period_mn * SAMPLES_PER_MINUTE : WTP_KEPT_SAMPLES;
+    _minute_first = firstAvailable(_minute_end, minutes, 0);
+    _sample_first = firstAvailable(_sample_end, samples, 0);
+  }
+
+  if (!_payload_config.has_wind_samples) {
+    _sample_first = _sample_end;
+  }
+  _selected = true;
+}
+
+unsigned int WN_WTP_PAYLOAD::countReportLines() {
+  if (!_replay_log) {
+    return _minute_end - _minute_first;
+  }
+
+  unsigned int lines = 0;
+  wn_wind_report_t report;
+  bool after_reboot = false;
+  for (uint32_t seq = _log_end_seq; seq != _log_first_seq && !after_reboot; seq--) {
+    if (!_anemometer->getLoggedMinuteReport(seq - 1, &report, &after_reboot)) {
+      break;
+    }
+    lines++;
+  }
+  return lines;
+}
+
+bool WN_WTP_PAYLOAD::getReportForLine(unsigned int line_index, wn_wind_report_t *report) {
+  if (_replay_log) {
+    return _anemometer->getLoggedMinuteReport(_log_end_seq - 1 - line_index, report);
+  }
+  // closed minutes are read from the report cache of the anemometer, they are not recomputed
+  uint32_t seq = _minute_end - 1 - line_index;
+  return _anemometer->getMinuteReport(_anemometer->getClosedMinuteCount() - 1 - seq, report);
+}
+
+// the key is no longer sent, payloads are signed with HMAC-SHA256 keyed with it
+void WN_WTP_PAYLOAD::enableHmacSigning() {
+  _payload_config.hmac_enabled = true;
+}
+
+// compact binary payload instead of text, to be posted with getContentType()
+void WN_WTP_PAYLOAD::enableBinaryEncoding() {
+  _payload_config.binary_encoding = true;
+}
+
 void WN_WTP_PAYLOAD::enableWindSamples() {
   _payload_config.has_wind_samples = true;
 }
@@ -61,200 +191,387 @@ void WN_WTP_PAYLOAD::setMeta(const char* meta) {
   _payload_config.has_meta = true;
 }
 
+#if WIND_ROSE
+// wind rose line of the text encoding, give a copy taken with snapshot() so it doesn't change
+// between calculatePayloadLength() and sendPayload()
+void WN_WTP_PAYLOAD::setWindRose(WN_WIND_ROSE* wind_rose) {
+  _wind_rose = wind_rose;
+  _payload_config.has_wind_rose = true;
+}
+#endif
+
 void WN_WTP_PAYLOAD::setSecretKey(char* secret_key) {
   _secret_key = secret_key;
 }
 
-#define SPEED_MAX_LENGTH 4  // 99.9 m/s
-#define DIR_MAX_LENGTH 4    // 359
-
-#define TEMP_MAX_LENGTH 5      //-99.0 C/F
-#define HUM_MAX_LENGTH 3       // 100
-#define PRESSURE_MAX_LENGTH 6  // 1099.9
-#define VOLTAGE_MAX_LENGTH 4   // 4.30
-#define RSSI_MAX_LENGTH 5      // -99.9
-#define TEMP_IN_MAX_LENGTH 5   //-99.0
-#define META_MAX_LENGTH 512
-
-
+// dry run of the payload: the length is exact, no worst case field widths
+// records are selected now, so sendPayload() emits the same bytes even if samples arrived meanwhile
 unsigned int WN_WTP_PAYLOAD::calculatePayloadLength() {
 
-  unsigned int payload_length = 0;
+  selectRecords();
 
-  payload_length += 3 + strlen(_secret_key);  //k=;
+  WN_WTP_WRITER counter;
+  writePayload(counter);
+  return counter.getCount();
+}
 
-  const unsigned int wind_report_length = (4 + SPEED_MAX_LENGTH) * 3 + (4 + DIR_MAX_LENGTH) + 2;  // r;
 
-  // first report line with extra data
-  payload_length += wind_report_length;
-  if (_payload_config.has_temperature) {
-    payload_length += TEMP_MAX_LENGTH + 4;
-  }
-  if (_payload_config.has_humidity) {
-    payload_length += HUM_MAX_LENGTH + 4;
-  }
-  if (_payload_config.has_pressure) {
-    payload_length += PRESSURE_MAX_LENGTH + 4;
-  }
+// compose and print 1 or more wind reports via WTP
+void WN_WTP_PAYLOAD::composeAndSendReportLine(unsigned int line_index, WN_WTP_WRITER& writer) {
 
-  // following report lines (only wind)
-  payload_length += (_period_mn - 1) * wind_report_length;
+  wn_wind_report_t report;
+  getReportForLine(line_index, &report);
 
-  // log line: l;
-  if (_payload_config.has_voltage || _payload_config.has_rssi || _payload_config.has_temp_in || _payload_config.has_meta) {
-    payload_length += 2;
-    if (_payload_config.has_voltage) {
-      payload_length += VOLTAGE_MAX_LENGTH + 4;
-    }
-    if (_payload_config.has_rssi) {
-      payload_length += RSSI_MAX_LENGTH + 4;
+  writer.beginLine();
+  writer.print("r,wa=");
+  writer.printFloat(report.avg_speed, 1);
+  writer.print(",wd=");
+  writer.printScaled(report.avg_dir, 0);
+  writer.print(",wn=");
+  writer.printFloat(report.min_speed, 1);
+  writer.print(",wx=");
+  writer.printFloat(report.max_speed, 1);
+
+  if (line_index == 0) {
+    if (_payload_config.has_temperature) {
+      writer.print(",tp=");
+      writer.printFloat(_temperature, 1);
     }
-    if (_payload_config.has_temp_in) {
-      payload_length += TEMP_IN_MAX_LENGTH + 4;
+    if (_payload_config.has_humidity) {
+      writer.print(",hu=");
+      writer.printFloat(_humidity, 0);
     }
-    if (_payload_config.has_meta) {
-      payload_length += strlen(_meta) + 4;
+    if (_payload_config.has_pressure) {
+      writer.print(",pr=");
+      writer.printFloat(_pressure, 1);
     }
   }
 
-  if (_payload_config.has_wind_samples) {
-    payload_length += _period_mn * 20 * (SPEED_MAX_LENGTH + DIR_MAX_LENGTH + 10);
+  writer.endLine();
+}
+
+
+// compose and print a log line via WTP
+void WN_WTP_PAYLOAD::composeAndSendLogLine(WN_WTP_WRITER& writer) {
+
+  writer.beginLine();
+  writer.print("l");
+
+  if (_payload_config.has_voltage) {
+    writer.print(",vo=");
+    writer.printFloat(_voltage, 2);
+  }
+  if (_payload_config.has_rssi) {
+    writer.print(",rs=");
+    writer.printFloat(_rssi, 1);
+  }
+  if (_payload_config.has_temp_in) {
+    writer.print(",ti=");
+    writer.printFloat(_temp_in, 1);
+  }
+  if (_payload_config.has_meta) {
+    writer.print(",mt=");
+    writer.print(_meta);
   }
 
-  return payload_length;
+  writer.endLine();
 }
 
 
-// compose and print 1 or more wind reports via WTP
-void WN_WTP_PAYLOAD::composeAndSendReportLine(unsigned int line_index, Print* modem, Print* debug) {
-
-  String line = "r";
-  wn_wind_report_t report = _anemometer->computeReportForPeriodInSecIndexedFromLast(60, line_index);
-
-  char wa[SPEED_MAX_LENGTH + 1], wn[SPEED_MAX_LENGTH + 1], wx[SPEED_MAX_LENGTH + 1], wd[DIR_MAX_LENGTH + 1];
-  dtostrf(report.avg_speed, SPEED_MAX_LENGTH, 1, wa);
-  dtostrf(report.min_speed, SPEED_MAX_LENGTH, 1, wn);
-  dtostrf(report.max_speed, SPEED_MAX_LENGTH, 1, wx);
-  dtostrf(report.avg_dir, DIR_MAX_LENGTH, 0, wd);
-  line += ",wa=";
-  line += wa;
-  line += ",wd=";
-  line += wd;
-  line += ",wn=";
-  line += wn;
-  line += ",wx=";
-  line += wx;
-
-  if (line_index == 0) {
-    if (_payload_config.has_temperature) {
-      char temperature[TEMP_MAX_LENGTH + 1];
-      dtostrf(_temperature, TEMP_MAX_LENGTH, 1, temperature);
-      line += ",tp=";
-      line += temperature;
+#if WIND_ROSE
+// compose and print a wind rose line via WTP: counts of each sector, classes separated by ':' with
+// the trailing zero counts left out, sectors separated by '/'
+void WN_WTP_PAYLOAD::composeAndSendWindRoseLine(WN_WTP_WRITER& writer) {
+
+  uint8_t sectors = _wind_rose->getSectorCount();
+  uint8_t classes = _wind_rose->getClassCount();
+
+  writer.beginLine();
+  writer.print("w,sq=");
+  writer.print(_wind_rose->getLastSampleSeq());
+  writer.print(",sn=");
+  writer.print(_wind_rose->getSampleCount());
+  writer.print(",se=");
+  writer.print(sectors);
+  writer.print(",cl=");
+  for (uint8_t c = 0; c + 1 < classes; c++) {
+    if (c > 0) {
+      writer.print(":");
     }
-    if (_payload_config.has_humidity) {
-      char humidity[HUM_MAX_LENGTH + 1];
-      dtostrf(_humidity, HUM_MAX_LENGTH, 0, humidity);
-      line += ",hu=";
-      line += humidity;
+    writer.printFloat(_wind_rose->getClassLimit(c), 1);
+  }
+  writer.print(",bi=");
+  for (uint8_t s = 0; s < sectors; s++) {
+    if (s > 0) {
+      writer.print("/");
     }
-    if (_payload_config.has_pressure) {
-      char pressure[PRESSURE_MAX_LENGTH + 1];
-      dtostrf(_pressure, PRESSURE_MAX_LENGTH, 1, pressure);
-      line += ",pr=";
-      line += pressure;
+    uint8_t used = classes;
+    while (used > 0 && _wind_rose->getCount(s, used - 1) == 0) {
+      used--;
+    }
+    for (uint8_t c = 0; c < used; c++) {
+      if (c > 0) {
+        writer.print(":");
+      }
+      writer.print(_wind_rose->getCount(s, c));
     }
   }
+  writer.endLine();
+}
+#endif
 
-  line += ";";
 
-  modem->print(line);
+// compose a message to send aggregated instant wind samples via WTP
+void WN_WTP_PAYLOAD::composeAndSendSampleLine(unsigned int line, WN_WTP_WRITER& writer) {
+  uint32_t seq = _sample_end - 1 - line;
+  wn_instant_wind_sample_t sample = _anemometer->getSampleIndexedFromLast(_anemometer->getSampleCount() - 1 - seq);
+
+  writer.beginLine();
+  writer.print("s,wi=");
+  writer.printFloat(sample.speed, 1);
+  writer.print(",wd=");
+  writer.printScaled(sample.dir, 0);
+  writer.endLine();
+}
 
-  if (debug) {
+
+// the payload is streamed line by line, nothing is allocated on the heap
+void WN_WTP_PAYLOAD::sendPayload(Print* modem, Print* debug) {
+
+  // same records as when the length was calculated
+  if (!_selected) {
+    selectRecords();
+  }
+  _sent_minute_end = _minute_end;
+  _sent_sample_end = _sample_end;
+  // the next payload selects its records again, with or without calculatePayloadLength()
+  _selected = false;
+
+  // binary bytes are not copied to the debug output
+  WN_WTP_WRITER writer(modem, _payload_config.binary_encoding ? NULL : debug);
+  if (_payload_config.hmac_enabled) {
+    writeSignedPayload(writer);
+  } else {
+    writePayload(writer);
+  }
+  if (_payload_config.binary_encoding && debug) {
     debug->print("Sent to modem: ");
-    debug->println(line);
+    debug->print(writer.getCount());
+    debug->println(" bytes of binary WTP");
   }
 }
 
+// the signer sees the bytes as they are sent, the payload is never held in RAM. Not inlined, so that
+// the ~200 bytes of the signer are on the stack only while signing.
+__attribute__((noinline)) void WN_WTP_PAYLOAD::writeSignedPayload(WN_WTP_WRITER& writer) {
+  WN_HMAC_SHA256 signer;
+  signer.begin((const uint8_t*)_secret_key, strlen(_secret_key));
+  writer.setSigner(&signer);
+  writePayload(writer);
+  writer.setSigner(NULL);
+}
 
-// compose and print a log line via WTP
-void WN_WTP_PAYLOAD::composeAndSendLogLine(Print* modem, Print* debug) {
+// identifies the key without revealing it: first bytes of its SHA-256
+void WN_WTP_PAYLOAD::computeKeyId(uint8_t key_id[WTP_KEY_ID_SIZE]) {
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  WN_SHA256 sha;
+  sha.begin();
+  sha.update((const uint8_t*)_secret_key, strlen(_secret_key));
+  sha.finish(digest);
+  memcpy(key_id, digest, WTP_KEY_ID_SIZE);
+}
 
-  String line = "l";
+const char* WN_WTP_PAYLOAD::getContentType() {
+  return _payload_config.binary_encoding ? "application/octet-stream" : "text/plain";
+}
 
-  if (_payload_config.has_voltage) {
-    char voltage[VOLTAGE_MAX_LENGTH + 1];
-    dtostrf(_voltage, VOLTAGE_MAX_LENGTH, 2, voltage);
-    line += ",vo=";
-    line += voltage;
+// nan has no binary encoding and is sent as 0, values beyond 32 bits are clamped
+static int32_t roundScaled(float value, uint8_t decimals) {
+  if (isnan(value)) {
+    return 0;
   }
-  if (_payload_config.has_rssi) {
-    char rssi[RSSI_MAX_LENGTH + 1];
-    dtostrf(_rssi, RSSI_MAX_LENGTH, 1, rssi);
-    line += ",rs=";
-    line += rssi;
+  for (uint8_t i = 0; i < decimals; i++) {
+    value *= 10;
   }
-  if (_payload_config.has_temp_in) {
-    char temp_in[TEMP_IN_MAX_LENGTH + 1];
-    dtostrf(_temp_in, TEMP_IN_MAX_LENGTH, 1, temp_in);
-    line += ",ti=";
-    line += temp_in;
+  value = value < 0 ? value - 0.5f : value + 0.5f;
+  // 2147483648.0f is exactly 2^31, the first float above INT32_MAX
+  if (value >= 2147483648.0f) {
+    return INT32_MAX;
   }
-  if (_payload_config.has_meta) {
-    line += ",mt=";
-    line += _meta;
+  if (value <= -2147483648.0f) {
+    return INT32_MIN;
   }
+  return (int32_t)value;
+}
 
-  line += ";";
+static uint8_t hexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return 0;
+}
 
-  modem->print(line);
+// binary encoding, see docs/WTP.md
+void WN_WTP_PAYLOAD::writeBinaryPayload(WN_WTP_WRITER& writer) {
+
+  // sequence numbers follow the report and sample counts in incremental payloads
+  bool sequenced = _incremental;
+  writer.write('W');
+  writer.write('B');
+  writer.write(sequenced ? WTP_BINARY_VERSION_SEQUENCED : WTP_BINARY_VERSION);
+
+  if (_payload_config.hmac_enabled) {
+    uint8_t key_id[WTP_KEY_ID_SIZE];
+    computeKeyId(key_id);
+    writer.write(key_id, WTP_KEY_ID_SIZE);
+  } else {
+    // 16 hexadecimal characters key packed in 8 bytes
+    size_t key_length = strlen(_secret_key);
+    for (size_t i = 0; i < 16; i += 2) {
+      uint8_t high = i < key_length ? hexNibble(_secret_key[i]) : 0;
+      uint8_t low = i + 1 < key_length ? hexNibble(_secret_key[i + 1]) : 0;
+      writer.write((uint8_t)(high << 4 | low));
+    }
+  }
 
-  if (debug) {
-    debug->print("Sent to modem: ");
-    debug->println(line);
+  writer.write((uint8_t)_anemometer->getSpeedUnit());
+  float speed_per_pulse = _anemometer->getSpeedPerPulse();
+  uint32_t scale;
+  memcpy(&scale, &speed_per_pulse, sizeof(scale));
+  for (uint8_t i = 0; i < 4; i++) {
+    writer.write((uint8_t)(scale >> (8 * i)));
   }
-}
 
+  uint8_t fields = (_payload_config.has_temperature ? WTP_BINARY_TEMPERATURE : 0)
+                   | (_payload_config.has_humidity ? WTP_BINARY_HUMIDITY : 0)
+                   | (_payload_config.has_pressure ? WTP_BINARY_PRESSURE : 0)
+                   | (_payload_config.has_voltage ? WTP_BINARY_VOLTAGE : 0)
+                   | (_payload_config.has_rssi ? WTP_BINARY_RSSI : 0)
+                   | (_payload_config.has_temp_in ? WTP_BINARY_TEMP_IN : 0)
+                   | (_payload_config.has_meta ? WTP_BINARY_META : 0)
+                   | (_payload_config.hmac_enabled ? WTP_BINARY_SIGNED : 0);
+  writer.write(fields);
+
+  // same resolution as the text encoding
+  if (_payload_config.has_temperature) writer.writeZigzag(roundScaled(_temperature, 1));
+  if (_payload_config.has_humidity) writer.writeZigzag(roundScaled(_humidity, 0));
+  if (_payload_config.has_pressure) writer.writeZigzag(roundScaled(_pressure, 1));
+  if (_payload_config.has_voltage) writer.writeZigzag(roundScaled(_voltage, 2));
+  if (_payload_config.has_rssi) writer.writeZigzag(roundScaled(_rssi, 1));
+  if (_payload_config.has_temp_in) writer.writeZigzag(roundScaled(_temp_in, 1));
+  if (_payload_config.has_meta) {
+    size_t meta_length = strlen(_meta);
+    writer.writeVarint(meta_length);
+    writer.write((const uint8_t*)_meta, meta_length);
+  }
 
+  // 1 minute reports, speeds in tenths of the unit
+  unsigned int report_lines = countReportLines();
+  writer.writeVarint(report_lines);
+  if (sequenced && report_lines > 0) {
+    writer.writeVarint(_replay_log ? 0 : _minute_end - 1);
+    writer.writeVarint(_replay_log ? 0 : _minute_anchor - _minute_end);
+  }
+  for (unsigned i = 0; i < report_lines; i++) {
+    wn_wind_report_t report;
+    getReportForLine(i, &report);
+    writer.writeVarint(roundScaled(report.avg_speed, 1));
+    writer.writeVarint(roundScaled(report.min_speed, 1));
+    writer.writeVarint(roundScaled(report.max_speed, 1));
+    writer.writeVarint(report.avg_dir);
+  }
 
-// compose a message to send aggregated instant wind samples via WTP
-void WN_WTP_PAYLOAD::composeAndSendSampleLine(unsigned int line, Print* modem, Print* debug) {
-  wn_instant_wind_sample_t sample = _anemometer->getSampleIndexedFromLast(line);
-  char wi[SPEED_MAX_LENGTH + 1], wd[DIR_MAX_LENGTH + 1];
-  dtostrf(sample.speed, SPEED_MAX_LENGTH, 1, wi);
-  dtostrf(sample.dir, DIR_MAX_LENGTH, 0, wd);
-  char buffer[32];
-  sprintf(buffer, "s,wi=%s,wd=%s;", wi, wd);
-  modem->print(buffer);
-  if (debug) {
-    debug->print("Sent to modem: ");
-    debug->println(buffer);
+  // samples as deltas from the previous (more recent) one, direction delta wrapped to -180..179
+  unsigned int samples = _sample_end - _sample_first;
+  writer.writeVarint(samples);
+  if (sequenced && samples > 0) {
+    writer.writeVarint(_sample_end - 1);
+    writer.writeVarint(_sample_anchor - _sample_end);
+  }
+  int32_t previous_pulses = 0;
+  int32_t previous_dir = 0;
+  uint32_t newest_index = _anemometer->getSampleCount() - _sample_end;
+  for (unsigned i = 0; i < samples; i++) {
+    wn_raw_wind_sample_t sample = _anemometer->getRawSampleIndexedFromLast(newest_index + i);
+    int32_t dir_delta = ((int32_t)sample.dir - previous_dir + 540) % 360 - 180;
+    writer.writeZigzag((int32_t)sample.pulses - previous_pulses);
+    writer.writeZigzag(dir_delta);
+    previous_pulses = sample.pulses;
+    previous_dir = sample.dir;
+  }
+
+  if (_payload_config.hmac_enabled) {
+    uint8_t mac[SHA256_DIGEST_SIZE];
+    writer.finishSignature(mac);
+    writer.write(mac, SHA256_DIGEST_SIZE);
   }
+
+  uint16_t crc = writer.getCrc();
+  writer.write((uint8_t)crc);
+  writer.write((uint8_t)(crc >> 8));
+  writer.flush();
 }
 
+void WN_WTP_PAYLOAD::writePayload(WN_WTP_WRITER& writer) {
 
-void WN_WTP_PAYLOAD::sendPayload(Print* modem, Print* debug) {
+  if (_payload_config.binary_encoding) {
+    writeBinaryPayload(writer);
+    return;
+  }
 
-  char buffer[64];
-  sprintf(buffer, "k=%s;", _secret_key);
-  modem->print(buffer);
+  writer.beginLine();
+  if (_payload_config.hmac_enabled) {
+    uint8_t key_id[WTP_KEY_ID_SIZE];
+    computeKeyId(key_id);
+    writer.print("ki=");
+    writer.printHex(key_id, WTP_KEY_ID_SIZE);
+  } else {
+    writer.print("k=");
+    writer.print(_secret_key);
+  }
 
-  if (debug) {
-    debug->print("Sent to modem: ");
-    debug->println(buffer);
+  // sequence number of the most recent line and records closed after it, the server can place the lines in time
+  unsigned int report_lines = countReportLines();
+  unsigned int sample_lines = _sample_end - _sample_first;
+  if (_incremental && report_lines > 0 && !_replay_log) {
+    writer.print(",mq=");
+    writer.print(_minute_end - 1);
+    writer.print(",ma=");
+    writer.print(_minute_anchor - _minute_end);
+  }
+  if (_incremental && sample_lines > 0) {
+    writer.print(",sq=");
+    writer.print(_sample_end - 1);
+    writer.print(",sa=");
+    writer.print(_sample_anchor - _sample_end);
   }
+  writer.endLine();
 
-  for (unsigned i = 0; i < _period_mn; i++) {
-    composeAndSendReportLine(i, modem, debug);
+  for (unsigned i = 0; i < report_lines; i++) {
+    composeAndSendReportLine(i, writer);
   }
 
   if (_payload_config.has_voltage || _payload_config.has_rssi || _payload_config.has_temp_in || _payload_config.has_meta) {
-    composeAndSendLogLine(modem, debug);
+    composeAndSendLogLine(writer);
   }
 
-  if (_payload_config.has_wind_samples) {
-    for (unsigned i = 0; i < _period_mn * 20; i++) {
-      composeAndSendSampleLine(i, modem, debug);
-    }
+#if WIND_ROSE
+  if (_payload_config.has_wind_rose) {
+    composeAndSendWindRoseLine(writer);
+  }
+#endif
+
+  for (unsigned i = 0; i < sample_lines; i++) {
+    composeAndSendSampleLine(i, writer);
+  }
+
+  // signature of all the previous bytes
+  if (_payload_config.hmac_enabled) {
+    uint8_t mac[SHA256_DIGEST_SIZE];
+    writer.finishSignature(mac);
+    writer.beginLine();
+    writer.print("h=");
+    writer.printHex(mac, SHA256_DIGEST_SIZE);
+    writer.endLine();
   }
 }
@@ -9,6 +9,27 @@
 #pragma once
 #include "Arduino.h"
 #include "Windnerd_Core.h"
+#include "Windnerd_Wtp_Writer.h"
+
+#define WTP_BINARY_VERSION 1
+#define WTP_BINARY_VERSION_SEQUENCED 2
+
+// optional fields of the binary encoding, flags in the order values are written
+#define WTP_BINARY_TEMPERATURE 0x01
+#define WTP_BINARY_HUMIDITY 0x02
+#define WTP_BINARY_PRESSURE 0x04
+#define WTP_BINARY_VOLTAGE 0x08
+#define WTP_BINARY_RSSI 0x10
+#define WTP_BINARY_TEMP_IN 0x20
+#define WTP_BINARY_META 0x40
+#define WTP_BINARY_SIGNED 0x80
+
+#define WTP_KEY_ID_SIZE 8
+
+// records that can be selected for a payload: the oldest minute and samples in memory are skipped,
+// they could be gone when the payload is sent, up to a minute after its length was calculated
+#define WTP_KEPT_MINUTES (MINUTE_HISTORY_LENGTH - 1)
+#define WTP_KEPT_SAMPLES (ROLLING_BUFFER_LENGTH - SAMPLES_PER_MINUTE)
 
 
 typedef struct {
@@ -20,7 +41,11 @@ typedef struct {
   bool has_temp_in = false;
   bool has_meta = false;
   bool has_wind_samples = false;
+#if WIND_ROSE
+  bool has_wind_rose = false;
+#endif
   bool hmac_enabled = false;
+  bool binary_encoding = false;
 
 } wn_payload_config_t;
 
@@ -38,10 +63,23 @@ public:
   void setMeta(const char* meta);
   void setAnemometer(WN_Core* anemometer);
   void enableWindSamples();
+#if WIND_ROSE
+  void setWindRose(WN_WIND_ROSE* wind_rose);
+#endif
+  void enableBinaryEncoding();
+  void enableHmacSigning();
+  void enableIncrementalUpload(uint16_t max_reports = 20, uint16_t max_samples = 200);
+  void acknowledge();
+  void acknowledge(uint32_t minute_end_seq, uint32_t sample_end_seq);
+  uint32_t getSentMinuteEnd();
+  uint32_t getSentSampleEnd();
+  bool hasBacklog();
   void setPeriodInMinutes(unsigned int period_mn);
+  void replayWindLog(uint32_t first_seq, uint32_t end_seq);
   void setSecretKey(char* secret_key);
   void sendPayload(Print* modem, Print* debug = NULL);
   void reset();
+  const char* getContentType();
 
   unsigned int calculatePayloadLength();
 
@@ -55,9 +93,42 @@ private:
   float _rssi;
   float _temp_in;
   const char* _meta;
+#if WIND_ROSE
+  WN_WIND_ROSE* _wind_rose;
+#endif
   unsigned int _period_mn = 1;
+  bool _replay_log = false;
+  uint32_t _log_first_seq = 0;
+  uint32_t _log_end_seq = 0;
+  // records of the payload by sequence number, first to end - 1, and counts when they were selected
+  bool _selected = false;
+  uint32_t _minute_first = 0;
+  uint32_t _minute_end = 0;
+  uint32_t _minute_anchor = 0;
+  uint32_t _sample_first = 0;
+  uint32_t _sample_end = 0;
+  uint32_t _sample_anchor = 0;
+  // incremental upload, kept across reset()
+  bool _incremental = false;
+  uint16_t _max_reports = 20;
+  uint16_t _max_samples = 200;
+  uint32_t _acked_minute_end = 0;
+  uint32_t _acked_sample_end = 0;
+  uint32_t _sent_minute_end = 0;
+  uint32_t _sent_sample_end = 0;
   char* _secret_key;
-  void composeAndSendReportLine(unsigned int line_index, Print* modem, Print* debug);
-  void composeAndSendSampleLine(unsigned int line, Print* modem, Print* debug);
-  void composeAndSendLogLine(Print* modem, Print* debug);
+  void selectRecords();
+  uint32_t firstAvailable(uint32_t end, uint32_t kept, uint32_t acked_end);
+  unsigned int countReportLines();
+  bool getReportForLine(unsigned int line_index, wn_wind_report_t *report);
+  void composeAndSendReportLine(unsigned int line_index, WN_WTP_WRITER& writer);
+  void composeAndSendSampleLine(unsigned int line, WN_WTP_WRITER& writer);
+  void composeAndSendLogLine(WN_WTP_WRITER& writer);
+#if WIND_ROSE
+  void composeAndSendWindRoseLine(WN_WTP_WRITER& writer);
+#endif
+  void writePayload(WN_WTP_WRITER& writer);
+  void writeSignedPayload(WN_WTP_WRITER& writer);
+  void writeBinaryPayload(WN_WTP_WRITER& writer);
+  void computeKeyId(uint8_t key_id[WTP_KEY_ID_SIZE]);
 };
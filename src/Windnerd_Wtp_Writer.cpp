@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Windnerd_Wtp_Writer.h"
+
+static const int32_t powers_of_ten[] = {1, 10, 100, 1000, 10000};
+
+WN_WTP_WRITER::WN_WTP_WRITER(Print *modem, Print *debug)
+    : _modem(modem),
+      _debug(debug)
+{
+}
+
+size_t WN_WTP_WRITER::write(uint8_t c)
+{
+  if (_length == WTP_WRITER_BUFFER_SIZE)
+  {
+    flush();
+  }
+  _buffer[_length++] = c;
+  _count++;
+  _crc = wn_crc16_update(_crc, c);
+  return 1;
+}
+
+void WN_WTP_WRITER::flush()
+{
+  if (_signer)
+  {
+    _signer->update((const uint8_t *)_buffer, _length);
+  }
+  if (_length == 0 || _modem == NULL)
+  {
+    _length = 0;
+    return;
+  }
+  _modem->write((const uint8_t *)_buffer, _length);
+  if (_debug)
+  {
+    _debug->write((const uint8_t *)_buffer, _length);
+  }
+  _length = 0;
+}
+
+// print a fixed point value, e.g. scaled 123 with 1 decimal -> "12.3"
+void WN_WTP_WRITER::printScaled(int32_t scaled, uint8_t decimals)
+{
+  bool negative = scaled < 0;
+  printFixed(negative ? -(uint32_t)scaled : scaled, negative, decimals);
+}
+
+// round a float to a fixed point value once, then format it with integers
+// the sign is kept separately so that e.g. -0.04 prints "-0.0" like dtostrf()
+// nan and inf print as dtostrf() did, magnitudes beyond 32 bits are clamped
+void WN_WTP_WRITER::printFloat(float value, uint8_t decimals)
+{
+  if (isnan(value))
+  {
+    print("nan");
+    return;
+  }
+  bool negative = value < 0;
+  if (isinf(value))
+  {
+    print(negative ? "-inf" : "inf");
+    return;
+  }
+  float scaled = (negative ? -value : value) * powers_of_ten[decimals] + 0.5f;
+  // 4294967296.0f is the first float above UINT32_MAX
+  printFixed(scaled < 4294967296.0f ? (uint32_t)scaled : UINT32_MAX, negative, decimals);
+}
+
+void WN_WTP_WRITER::printFixed(uint32_t magnitude, bool negative, uint8_t decimals)
+{
+  char digits[12];
+  uint8_t n = 0;
+
+  // digits are produced from the least significant one
+  do
+  {
+    if (n == decimals && decimals > 0)
+    {
+      digits[n++] = '.';
+    }
+    digits[n++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude > 0 || n <= decimals);
+
+  if (negative)
+  {
+    digits[n++] = '-';
+  }
+  while (n > 0)
+  {
+    write(digits[--n]);
+  }
+}
+
+void WN_WTP_WRITER::beginLine()
+{
+  flush();
+  if (_debug)
+  {
+    _debug->print("Sent to modem: ");
+  }
+}
+
+void WN_WTP_WRITER::endLine()
+{
+  write(';');
+  flush();
+  if (_debug)
+  {
+    _debug->println();
+  }
+}
+
+// bytes written since construction, whether emitted or not
+uint32_t WN_WTP_WRITER::getCount()
+{
+  return _count;
+}
+
+// unsigned LEB128: 7 bits per byte, least significant group first, high bit set when more bytes follow
+void WN_WTP_WRITER::writeVarint(uint32_t value)
+{
+  while (value >= 0x80)
+  {
+    write((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  write((uint8_t)value);
+}
+
+// zigzag maps small signed values to small unsigned ones: 0, -1, 1, -2... -> 0, 1, 2, 3...
+void WN_WTP_WRITER::writeZigzag(int32_t value)
+{
+  writeVarint(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+// CRC-16-CCITT of every byte written so far
+uint16_t WN_WTP_WRITER::getCrc()
+{
+  return _crc;
+}
+
+// to be set before writing, every byte flushed is then signed
+void WN_WTP_WRITER::setSigner(WN_HMAC_SHA256 *signer)
+{
+  _signer = signer;
+}
+
+// MAC of every byte written so far, bytes written afterwards are not signed
+// without signer (dry run) the MAC is zeroed, it has the same length anyway
+void WN_WTP_WRITER::finishSignature(uint8_t mac[SHA256_DIGEST_SIZE])
+{
+  flush();
+  if (_signer)
+  {
+    _signer->finish(mac);
+    _signer = NULL;
+  }
+  else
+  {
+    memset(mac, 0, SHA256_DIGEST_SIZE);
+  }
+}
+
+void WN_WTP_WRITER::printHex(const uint8_t *data, size_t length)
+{
+  static const char digits[] = "0123456789abcdef";
+  for (size_t i = 0; i < length; i++)
+  {
+    write(digits[data[i] >> 4]);
+    write(digits[data[i] & 0x0F]);
+  }
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026, windnerd.net
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD 3-Clause License found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include "Arduino.h"
+#include "Windnerd_Crc.h"
+#include "Windnerd_Sha256.h"
+
+#define WTP_WRITER_BUFFER_SIZE 32
+
+// Streams a WTP payload to the modem through a small fixed buffer, without heap allocation.
+// Numbers are formatted with integer arithmetic, without padding.
+// Each line is also copied to the debug output if any.
+// Without modem, nothing is emitted and the writer only counts bytes (dry run).
+// A CRC of every byte written is kept for the binary encoding.
+// Flushed bytes are also fed to a signer if one is set, so signing needs no extra pass.
+class WN_WTP_WRITER : public Print
+{
+
+public:
+  WN_WTP_WRITER(Print *modem = NULL, Print *debug = NULL);
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+  void flush() override;
+
+  void printScaled(int32_t scaled, uint8_t decimals);
+  void printFloat(float value, uint8_t decimals);
+  void beginLine();
+  void endLine();
+  void writeVarint(uint32_t value);
+  void writeZigzag(int32_t value);
+  uint32_t getCount();
+  uint16_t getCrc();
+  void setSigner(WN_HMAC_SHA256 *signer);
+  void finishSignature(uint8_t mac[SHA256_DIGEST_SIZE]);
+  void printHex(const uint8_t *data, size_t length);
+
+private:
+  void printFixed(uint32_t magnitude, bool negative, uint8_t decimals);
+
+  Print *_modem;
+  Print *_debug;
+  char _buffer[WTP_WRITER_BUFFER_SIZE];
+  uint8_t _length = 0;
+  uint32_t _count = 0;
+  uint16_t _crc = WN_CRC16_INIT;
+  WN_HMAC_SHA256 *_signer = NULL;
+};